@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include "devices/ide.h"
 #include "threads/malloc.h"
+#include "threads/trace.h"
 
 /*! A block device. */
 struct block {
@@ -99,6 +100,7 @@ static void check_sector(struct block *block, block_sector_t sector) {
     per-block device locking is unneeded. */
 void block_read(struct block *block, block_sector_t sector, void *buffer) {
     check_sector(block, sector);
+    TRACE(TRACE_BLOCK_READ, sector, block->type);
     block->ops->read(block->aux, sector, buffer);
     block->read_cnt++;
 }
@@ -112,10 +114,53 @@ void block_write(struct block *block, block_sector_t sector,
                  const void *buffer) {
     check_sector(block, sector);
     ASSERT(block->type != BLOCK_FOREIGN);
+    TRACE(TRACE_BLOCK_WRITE, sector, block->type);
     block->ops->write(block->aux, sector, buffer);
     block->write_cnt++;
 }
 
+/*! Reads the CNT sectors starting at SECTOR from BLOCK, sector SECTOR + I
+    into BUFFERS[I], which must have room for BLOCK_SECTOR_SIZE bytes.  The
+    device sees a single request if its driver supports it.  CNT must be
+    between 1 and BLOCK_MULTI_MAX. */
+void block_read_multi(struct block *block, block_sector_t sector,
+                      block_sector_t cnt, void *const buffers[]) {
+    block_sector_t i;
+
+    ASSERT(cnt > 0 && cnt <= BLOCK_MULTI_MAX);
+    check_sector(block, sector);
+    check_sector(block, sector + cnt - 1);
+    TRACE(TRACE_BLOCK_READ, sector, block->type);
+    if (block->ops->read_multi != NULL)
+        block->ops->read_multi(block->aux, sector, cnt, buffers);
+    else
+        for (i = 0; i < cnt; i++)
+            block->ops->read(block->aux, sector + i, buffers[i]);
+    block->read_cnt += cnt;
+}
+
+/*! Writes the CNT sectors starting at SECTOR to BLOCK, sector SECTOR + I
+    from BUFFERS[I], which must contain BLOCK_SECTOR_SIZE bytes.  Returns
+    after the device has acknowledged all of them.  The device sees a
+    single request if its driver supports it.  CNT must be between 1 and
+    BLOCK_MULTI_MAX. */
+void block_write_multi(struct block *block, block_sector_t sector,
+                       block_sector_t cnt, const void *const buffers[]) {
+    block_sector_t i;
+
+    ASSERT(cnt > 0 && cnt <= BLOCK_MULTI_MAX);
+    check_sector(block, sector);
+    check_sector(block, sector + cnt - 1);
+    ASSERT(block->type != BLOCK_FOREIGN);
+    TRACE(TRACE_BLOCK_WRITE, sector, block->type);
+    if (block->ops->write_multi != NULL)
+        block->ops->write_multi(block->aux, sector, cnt, buffers);
+    else
+        for (i = 0; i < cnt; i++)
+            block->ops->write(block->aux, sector + i, buffers[i]);
+    block->write_cnt += cnt;
+}
+
 /*! Returns the number of sectors in BLOCK. */
 block_sector_t block_size(struct block *block) {
     return block->size;
@@ -15,6 +15,10 @@ typedef uint32_t block_sector_t;
 /*! Format specifier for printf(), e.g.:
     printf ("sector=%"PRDSNu"\n", sector); */
 #define PRDSNu PRIu32
+
+/*! Most sectors a single block_read_multi() or block_write_multi() may
+    transfer. */
+#define BLOCK_MULTI_MAX 256
 
 /*! Higher-level interface for file systems, etc. */
 
@@ -52,6 +56,10 @@ struct block *block_next(struct block *);
 block_sector_t block_size(struct block *);
 void block_read(struct block *, block_sector_t, void *);
 void block_write(struct block *, block_sector_t, const void *);
+void block_read_multi(struct block *, block_sector_t, block_sector_t cnt,
+                      void *const buffers[]);
+void block_write_multi(struct block *, block_sector_t, block_sector_t cnt,
+                       const void *const buffers[]);
 const char *block_name(struct block *);
 enum block_type block_type(struct block *);
 
@@ -63,6 +71,14 @@ void block_print_stats(void);
 struct block_operations {
     void (*read)(void *aux, block_sector_t, void *buffer);
     void (*write)(void *aux, block_sector_t, const void *buffer);
+
+    /*! Optional: transfer CNT consecutive sectors as one request, to or
+        from BUFFERS[0] through BUFFERS[CNT - 1].  Without them, the block
+        layer issues one read or write per sector. */
+    void (*read_multi)(void *aux, block_sector_t, block_sector_t cnt,
+                       void *const buffers[]);
+    void (*write_multi)(void *aux, block_sector_t, block_sector_t cnt,
+                        const void *const buffers[]);
 };
 
 struct block *block_register(const char *name, enum block_type,
@@ -75,7 +75,8 @@ struct channel {
     struct lock lock;           /*!< Must acquire to access the controller. */
     bool expecting_interrupt;   /*!< True if an interrupt is expected, false if
                                      any interrupt would be spurious. */
-    struct semaphore completion_wait;   /*!< Up'd by interrupt handler. */
+    bool completed;             /*!< Interrupt taken, waiter not yet woken. */
+    struct semaphore completion_wait;   /*!< Up'd by block softirq. */
 
     struct ata_disk devices[2];     /*!< The devices on this channel. */
 };
@@ -85,12 +86,16 @@ struct channel {
 static struct channel channels[CHANNEL_CNT];
 
 static struct block_operations ide_operations;
+static void ide_read_multi(void *, block_sector_t, block_sector_t,
+                           void *const []);
+static void ide_write_multi(void *, block_sector_t, block_sector_t,
+                            const void *const []);
 
 static void reset_channel(struct channel *);
 static bool check_device_type(struct ata_disk *);
 static void identify_ata_device(struct ata_disk *);
 
-static void select_sector(struct ata_disk *, block_sector_t);
+static void select_sector(struct ata_disk *, block_sector_t, block_sector_t);
 static void issue_pio_command(struct channel *, uint8_t command);
 static void input_sector(struct channel *, void *);
 static void output_sector(struct channel *, const void *);
@@ -101,11 +106,14 @@ static void select_device(const struct ata_disk *);
 static void select_device_wait(const struct ata_disk *);
 
 static void interrupt_handler(struct intr_frame *);
+static void ide_softirq(void);
 
 /*! Initialize the disk subsystem and detect disks. */
 void ide_init (void) {
     size_t chan_no;
 
+    softirq_register(SOFTIRQ_BLOCK, ide_softirq, "block");
+
     for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
         struct channel *c = &channels[chan_no];
         int dev_no;
@@ -126,6 +134,7 @@ void ide_init (void) {
         }
         lock_init(&c->lock);
         c->expecting_interrupt = false;
+        c->completed = false;
         sema_init(&c->completion_wait, 0);
  
         /* Initialize devices. */
@@ -319,16 +328,7 @@ static char * descramble_ata_string(char *string, int size) {
     BLOCK_SECTOR_SIZE bytes.  Internally synchronizes accesses to disks,
     so external per-disk locking is unneeded. */
 static void ide_read(void *d_, block_sector_t sec_no, void *buffer) {
-    struct ata_disk *d = d_;
-    struct channel *c = d->channel;
-    lock_acquire(&c->lock);
-    select_sector(d, sec_no);
-    issue_pio_command(c, CMD_READ_SECTOR_RETRY);
-    sema_down(&c->completion_wait);
-    if (!wait_while_busy(d))
-        PANIC("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-    input_sector(c, buffer);
-    lock_release(&c->lock);
+    ide_read_multi(d_, sec_no, 1, &buffer);
 }
 
 /*! Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -336,32 +336,70 @@ static void ide_read(void *d_, block_sector_t sec_no, void *buffer) {
     receiving the data.  Internally synchronizes accesses to disks, so external
     per-disk locking is unneeded. */
 static void ide_write(void *d_, block_sector_t sec_no, const void *buffer) {
+    ide_write_multi(d_, sec_no, 1, &buffer);
+}
+
+/*! Reads CNT sectors starting at SEC_NO from disk D with a single READ
+    SECTOR command, sector SEC_NO + I into BUFFERS[I].  The disk raises an
+    interrupt as each sector becomes ready. */
+static void ide_read_multi(void *d_, block_sector_t sec_no,
+                           block_sector_t cnt, void *const buffers[]) {
+    struct ata_disk *d = d_;
+    struct channel *c = d->channel;
+    block_sector_t i;
+
+    lock_acquire(&c->lock);
+    select_sector(d, sec_no, cnt);
+    issue_pio_command(c, CMD_READ_SECTOR_RETRY);
+    for (i = 0; i < cnt; i++) {
+        sema_down(&c->completion_wait);
+        if (!wait_while_busy(d))
+            PANIC("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no + i);
+        input_sector(c, buffers[i]);
+    }
+    lock_release(&c->lock);
+}
+
+/*! Writes CNT sectors starting at SEC_NO to disk D with a single WRITE
+    SECTOR command, sector SEC_NO + I from BUFFERS[I].  The disk raises an
+    interrupt as it takes each sector.  Returns after the last one. */
+static void ide_write_multi(void *d_, block_sector_t sec_no,
+                            block_sector_t cnt, const void *const buffers[]) {
     struct ata_disk *d = d_;
     struct channel *c = d->channel;
+    block_sector_t i;
+
     lock_acquire(&c->lock);
-    select_sector(d, sec_no);
+    select_sector(d, sec_no, cnt);
     issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
-    if (!wait_while_busy(d))
-        PANIC("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-    output_sector(c, buffer);
-    sema_down(&c->completion_wait);
+    for (i = 0; i < cnt; i++) {
+        if (!wait_while_busy(d))
+            PANIC("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no + i);
+        output_sector(c, buffers[i]);
+        sema_down(&c->completion_wait);
+    }
     lock_release(&c->lock);
 }
 
 static struct block_operations ide_operations = {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multi,
+    ide_write_multi
 };
 
 /*! Selects device D, waiting for it to become ready, and then writes SEC_NO
-    to the disk's sector selection registers.  (We use LBA mode.) */
-static void select_sector(struct ata_disk *d, block_sector_t sec_no) {
+    and the sector count CNT to the disk's sector selection registers.  (We
+    use LBA mode.)  A count register of 0 means 256 sectors. */
+static void select_sector(struct ata_disk *d, block_sector_t sec_no,
+                          block_sector_t cnt) {
     struct channel *c = d->channel;
 
     ASSERT(sec_no < (1UL << 28));
+    ASSERT(cnt > 0 && cnt <= BLOCK_MULTI_MAX);
   
     select_device_wait(d);
-    outb(reg_nsect(c), 1);
+    outb(reg_nsect(c), cnt & 0xff);
     outb(reg_lbal(c), sec_no);
     outb(reg_lbam(c), sec_no >> 8);
     outb(reg_lbah(c), (sec_no >> 16));
@@ -460,7 +498,8 @@ static void interrupt_handler(struct intr_frame *f) {
         if (f->vec_no == c->irq) {
             if (c->expecting_interrupt) {
                 inb (reg_status (c));             /* Acknowledge interrupt. */
-                sema_up (&c->completion_wait);    /* Wake up waiter. */
+                c->completed = true;              /* Wake up waiter */
+                softirq_raise (SOFTIRQ_BLOCK);    /* from softirq. */
             }
             else {
                 printf ("%s: unexpected interrupt\n", c->name);
@@ -472,4 +511,20 @@ static void interrupt_handler(struct intr_frame *f) {
     NOT_REACHED();
 }
 
+/*! Block softirq: wakes the threads waiting on channels whose interrupt
+    has been taken. */
+static void ide_softirq(void) {
+    struct channel *c;
+
+    for (c = channels; c < channels + CHANNEL_CNT; c++) {
+        enum intr_level old_level = intr_disable();
+        bool completed = c->completed;
+        c->completed = false;
+        intr_set_level(old_level);
+
+        if (completed)
+            sema_up(&c->completion_wait);
+    }
+}
+
 
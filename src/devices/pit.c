@@ -15,9 +15,6 @@
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /*!< Counter port. */
 /*! @} */
 
-/*! PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /*! Configure the given CHANNEL in the PIT.  In a PC, the PIT's
     three output channels are hooked up like this:
 
@@ -79,3 +76,42 @@ void pit_configure_channel(int channel, int mode, int frequency) {
     intr_set_level(old_level);
 }
 
+
+/*! Starts CHANNEL counting down COUNT PIT cycles, once, in mode 0
+    ("interrupt on terminal count").  The channel's output goes high when the
+    count reaches zero, which for channel 0 raises a single timer interrupt,
+    and then stays high until the channel is reprogrammed.  COUNT must be
+    nonzero. */
+void pit_start_oneshot(int channel, uint16_t count) {
+    enum intr_level old_level;
+
+    ASSERT(channel == 0);
+    ASSERT(count > 0);
+
+    old_level = intr_disable();
+    outb(PIT_PORT_CONTROL, (channel << 6) | 0x30 | (0 << 1));
+    outb(PIT_PORT_COUNTER(channel), count);
+    outb(PIT_PORT_COUNTER(channel), count >> 8);
+    intr_set_level(old_level);
+}
+
+/*! Returns the current count of CHANNEL, and stores the state of the
+    channel's output pin in *OUTPUT.  Uses the 8254 read-back command to
+    latch the count and status together, so the two are consistent. */
+uint16_t pit_read_channel(int channel, bool *output) {
+    enum intr_level old_level;
+    uint8_t status, lo, hi;
+
+    ASSERT(channel == 0 || channel == 2);
+    ASSERT(output != NULL);
+
+    old_level = intr_disable();
+    outb(PIT_PORT_CONTROL, 0xc0 | (2 << channel));
+    status = inb(PIT_PORT_COUNTER(channel));
+    lo = inb(PIT_PORT_COUNTER(channel));
+    hi = inb(PIT_PORT_COUNTER(channel));
+    intr_set_level(old_level);
+
+    *output = (status & 0x80) != 0;
+    return lo | (hi << 8);
+}
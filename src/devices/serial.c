@@ -63,10 +63,14 @@ static enum { UNINIT, POLL, QUEUE } mode;
 /*! Data to be transmitted. */
 static struct intq txq;
 
+/*! Data received, not yet passed to the input layer. */
+static struct intq rxq;
+
 static void set_serial(int bps);
 static void putc_poll(uint8_t);
 static void write_ier(void);
 static intr_handler_func serial_interrupt;
+static void serial_softirq(void);
 
 /*! Initializes the serial port device for polling mode.  Polling mode
     busy-waits for the serial port to become free before writing to it.  It's
@@ -78,6 +82,7 @@ static void init_poll(void) {
     set_serial(9600);                    /* 9.6 kbps, N-8-1. */
     outb(MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
     intq_init(&txq);
+    intq_init(&rxq);
     mode = POLL;
 } 
 
@@ -92,6 +97,7 @@ void serial_init_queue(void) {
     ASSERT(mode == POLL);
 
     intr_register_ext(0x20 + 4, serial_interrupt, "serial");
+    softirq_register(SOFTIRQ_SERIAL, serial_softirq, "serial");
     mode = QUEUE;
     old_level = intr_disable();
     write_ier();
@@ -141,8 +147,12 @@ void serial_flush(void) {
     to or removed from the buffer. */
 void serial_notify(void) {
     ASSERT(intr_get_level() == INTR_OFF);
-    if (mode == QUEUE)
+    if (mode == QUEUE) {
+        /* Room may have been made for input held back in rxq. */
+        if (!intq_empty(&rxq) && !input_full())
+            softirq_raise(SOFTIRQ_SERIAL);
         write_ier();
+    }
 }
 
 /*! Configures the serial port for BPS bits per second. */
@@ -175,7 +185,7 @@ static void write_ier(void) {
 
     /* Enable receive interrupt if we have room to store any
        characters we receive. */
-    if (!input_full())
+    if (!intq_full(&rxq))
         ier |= IER_RECV;
   
     outb(IER_REG, ier);
@@ -197,9 +207,12 @@ static void serial_interrupt(struct intr_frame *f UNUSED) {
     inb(IIR_REG);
 
     /* As long as we have room to receive a byte, and the hardware
-       has a byte for us, receive a byte.  */
-    while (!input_full() && (inb(LSR_REG) & LSR_DR) != 0)
-        input_putc(inb(RBR_REG));
+       has a byte for us, receive a byte.  The serial softirq passes
+       them on to the input layer. */
+    while (!intq_full(&rxq) && (inb(LSR_REG) & LSR_DR) != 0)
+        intq_putc(&rxq, inb(RBR_REG));
+    if (!intq_empty(&rxq))
+        softirq_raise(SOFTIRQ_SERIAL);
 
     /* As long as we have a byte to transmit, and the hardware is
        ready to accept a byte for transmission, transmit a byte. */
@@ -210,3 +223,15 @@ static void serial_interrupt(struct intr_frame *f UNUSED) {
     write_ier();
 }
 
+/*! Serial softirq: passes received bytes to the input layer, for as long
+    as it has room for them. */
+static void serial_softirq(void) {
+    enum intr_level old_level = intr_disable();
+
+    while (!intq_empty(&rxq) && !input_full())
+        input_putc(intq_getc(&rxq));
+    write_ier();
+
+    intr_set_level(old_level);
+}
+
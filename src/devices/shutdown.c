@@ -4,8 +4,12 @@
 #include "devices/kbd.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/irqsoff.h"
+#include "threads/profile.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
@@ -13,6 +17,10 @@
 #include "devices/block.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/pageout.h"
+#include "vm/replace.h"
+#endif
 
 /*! Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -79,6 +87,7 @@ void shutdown_power_off(void) {
     const char *p;
 
 #ifdef FILESYS
+    trace_dump();
     filesys_done();
 #endif
 
@@ -105,7 +114,10 @@ void shutdown_power_off(void) {
 /*! Print statistics about Pintos execution. */
 static void print_stats(void) {
     timer_print_stats();
+    intr_print_stats();
     thread_print_stats();
+    irqsoff_print();
+    profile_print();
 #ifdef FILESYS
     block_print_stats();
 #endif
@@ -114,5 +126,9 @@ static void print_stats(void) {
 #ifdef USERPROG
     exception_print_stats();
 #endif
+#ifdef VM
+    replace_print_stats();
+    pageout_print_stats();
+#endif
 }
 
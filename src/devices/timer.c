@@ -9,7 +9,9 @@
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
+#include "threads/flags.h"
 #include "threads/interrupt.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
   
@@ -26,17 +28,81 @@ static int64_t ticks;
 /*! Number of loops per timer tick.  Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/*! Clocksource for timer_now_ns().  timer_calibrate() measures the rate of
+    the CPU's time-stamp counter against the PIT; from then on the clock is
+    the TSC, counted from a tick boundary.  Before that, or on a CPU without
+    a TSC, the clock only advances once per tick.
+    @{ */
+#define TSC_CALIBRATE_TICKS 10          /*!< Length of the calibration. */
+static uint64_t tsc_hz;                 /*!< TSC rate, 0 if not in use. */
+static uint64_t tsc_base;               /*!< TSC at tick TSC_BASE_TICK. */
+static int64_t tsc_base_tick;
+/*! @} */
+
+/*! Dynamic tick ("-tickless").  While the idle thread waits, the PIT is
+    switched from a periodic interrupt to a single one that fires on the
+    tick boundary when the next timer event is due.  The one-shot always
+    ends on a tick boundary, so that the periodic tick, restarted when it
+    fires, keeps its phase and timer_ticks() does not drift.
+
+    The PIT's 16-bit counter limits a one-shot to ONESHOT_MAX_TICKS ticks
+    (5 at 100 Hz).  Longer idle periods are covered by a chain of
+    one-shots: each one wakes the idle thread, which arms the next.
+    @{ */
+bool timer_tickless;
+#define PIT_CYCLES_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define ONESHOT_MAX_TICKS (UINT16_MAX / PIT_CYCLES_PER_TICK)
+static int64_t oneshot_ticks;   /*!< Ticks counted when the one-shot fires,
+                                     0 if none is running. */
+static int oneshot_phase;       /*!< PIT cycles from the last tick counted in
+                                     TICKS to the start of the one-shot. */
+static unsigned oneshot_cycles; /*!< Length of the one-shot in PIT cycles. */
+/*! @} */
+
+/*! Hierarchical timer wheel holding all pending timer events.  Level 0 has
+    one slot per tick for events due within the next WHEEL_SLOTS ticks; each
+    higher level has slots WHEEL_SLOTS times as wide.  When level 0 wraps
+    around, the next slot of level 1 is "cascaded", that is, its events are
+    redistributed into the finer levels, and so on up the hierarchy.  Adding,
+    cancelling and expiring an event are all O(1), no matter how many events
+    are pending.  Protected by disabling interrupts.
+    @{ */
+#define WHEEL_BITS 6                                /*!< Bits per level. */
+#define WHEEL_SLOTS (1 << WHEEL_BITS)               /*!< Slots per level. */
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4                              /*!< Number of levels. */
+#define WHEEL_SPAN ((int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS))
+static struct list wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+static int64_t wheel_ticks;     /*!< Next tick whose events will run. */
+/*! @} */
+
 static intr_handler_func timer_interrupt;
+static void start_oneshot(int phase, int64_t n);
+static void wheel_insert(struct timer_event *);
+static void wheel_cascade(int level);
+static void wheel_run(void);
+static bool wheel_slot_empty(int64_t tick);
+static void advance_ticks(int64_t n);
 static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
+static bool tsc_present(void);
+static uint64_t tsc_read(void);
+static void tsc_calibrate(void);
 static void real_time_sleep(int64_t num, int32_t denom);
 static void real_time_delay(int64_t num, int32_t denom);
 
 /*! Sets up the timer to interrupt TIMER_FREQ times per second,
     and registers the corresponding interrupt. */
 void timer_init(void) {
+    int level, slot;
+
+    for (level = 0; level < WHEEL_LEVELS; level++)
+        for (slot = 0; slot < WHEEL_SLOTS; slot++)
+            list_init(&wheel[level][slot]);
+
     pit_configure_channel(0, 2, TIMER_FREQ);
     intr_register_ext(0x20, timer_interrupt, "8254 Timer");
+    softirq_register(SOFTIRQ_TIMER, wheel_run, "timer");
 }
 
 /*! Calibrates loops_per_tick, used to implement brief delays. */
@@ -62,6 +128,8 @@ void timer_calibrate(void) {
     }
 
     printf("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+    tsc_calibrate();
 }
 
 /*! Returns the number of timer ticks since the OS booted. */
@@ -78,6 +146,23 @@ int64_t timer_elapsed(int64_t then) {
     return timer_ticks() - then;
 }
 
+/*! Returns the number of nanoseconds since the OS booted.  The clock never
+    goes backward, and once timer_calibrate() has run it has the resolution
+    of the TSC rather than of the timer tick.  May be called from an
+    interrupt handler. */
+int64_t timer_now_ns(void) {
+    uint64_t cycles;
+
+    if (tsc_hz == 0)
+        return timer_ticks() * NS_PER_TICK;
+
+    /* Split the conversion so the multiplication cannot overflow. */
+    cycles = tsc_read() - tsc_base;
+    return tsc_base_tick * NS_PER_TICK +
+           (int64_t) (cycles / tsc_hz * 1000000000 +
+                      cycles % tsc_hz * 1000000000 / tsc_hz);
+}
+
 /*! Sleeps for approximately TICKS timer ticks.  Interrupts must
     be turned on. */
 void timer_sleep(int64_t ticks) {
@@ -134,10 +219,242 @@ void timer_print_stats(void) {
     printf("Timer: %"PRId64" ticks\n", timer_ticks());
 }
 
+/*! Arranges for FUNC to be called with AUX from the timer interrupt at tick
+    DEADLINE (as returned by timer_ticks()), or at the next tick if DEADLINE
+    has already passed.  EVENT, which must not already be pending, provides
+    the storage and must stay valid until the callback runs or the event is
+    cancelled.  May be called from an interrupt handler. */
+void timer_add(struct timer_event *event, int64_t deadline,
+               timer_callback_func *func, void *aux) {
+    enum intr_level old_level;
+
+    ASSERT(event != NULL);
+    ASSERT(func != NULL);
+
+    old_level = intr_disable();
+    ASSERT(!event->pending);
+    event->deadline = deadline;
+    event->func = func;
+    event->aux = aux;
+    event->pending = true;
+    wheel_insert(event);
+    intr_set_level(old_level);
+}
+
+/*! Cancels EVENT if it is still pending.  Returns true if it was, false if
+    it had already fired (or was never added). */
+bool timer_cancel(struct timer_event *event) {
+    enum intr_level old_level;
+    bool was_pending;
+
+    ASSERT(event != NULL);
+
+    old_level = intr_disable();
+    was_pending = event->pending;
+    if (was_pending) {
+        list_remove(&event->elem);
+        event->pending = false;
+    }
+    intr_set_level(old_level);
+
+    return was_pending;
+}
+
+/*! Called by the idle thread, with interrupts off, just before it halts the
+    CPU.  In tickless mode, replaces the periodic timer interrupt by a single
+    one at the next tick that has work to do: a timer event is due, or the
+    timer wheel cascades.  Does nothing if that is the very next tick. */
+void timer_enter_idle(void) {
+    uint16_t remaining;
+    bool output;
+    int64_t n;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!timer_tickless || oneshot_ticks != 0)
+        return;
+
+    /* Events left due by a timer softirq that has yet to run need the
+       next tick. */
+    if (wheel_ticks <= ticks)
+        return;
+
+    /* wheel_ticks is ticks + 1 here, so tick TICKS + N is due iff its
+       level 0 slot is non-empty.  Don't sleep past a level 0 wrap around,
+       where events from the coarser levels may cascade in. */
+    for (n = 1; n < ONESHOT_MAX_TICKS; n++) {
+        if (!wheel_slot_empty(ticks + n) || ((ticks + n) & WHEEL_MASK) == 0)
+            break;
+    }
+    if (n <= 1)
+        return;
+
+    /* The periodic count says how far into the current tick we are. */
+    remaining = pit_read_channel(0, &output);
+    if (remaining == 0 || remaining > PIT_CYCLES_PER_TICK)
+        remaining = PIT_CYCLES_PER_TICK;
+    start_oneshot(PIT_CYCLES_PER_TICK - remaining, n);
+}
+
+/*! Starts a one-shot timer interrupt on the Nth tick boundary after the last
+    tick counted in TICKS, PHASE PIT cycles after that tick.  Interrupts must
+    be off. */
+static void start_oneshot(int phase, int64_t n) {
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(phase >= 0 && phase < PIT_CYCLES_PER_TICK);
+    ASSERT(n >= 1 && n <= ONESHOT_MAX_TICKS);
+
+    oneshot_ticks = n;
+    oneshot_phase = phase;
+    oneshot_cycles = n * PIT_CYCLES_PER_TICK - phase;
+    pit_start_oneshot(0, oneshot_cycles);
+}
+
+/*! Called on every external interrupt other than the timer's.  If the idle
+    thread stopped the periodic tick, accounts for the whole ticks that have
+    passed since.  The partial tick is not rounded off: the one-shot is cut
+    short at the next tick boundary, where timer_interrupt() counts that
+    tick and restores the periodic tick in phase. */
+void timer_exit_idle(void) {
+    uint16_t remaining;
+    bool expired;
+    int64_t since, elapsed;
+
+    ASSERT(intr_context());
+
+    if (oneshot_ticks == 0)
+        return;
+
+    remaining = pit_read_channel(0, &expired);
+    if (expired) {
+        /* The one-shot timer interrupt is already pending and will do the
+           accounting itself. */
+        return;
+    }
+
+    /* PIT cycles since the last tick counted in TICKS. */
+    since = oneshot_phase + (int64_t) (oneshot_cycles - remaining);
+    elapsed = since / PIT_CYCLES_PER_TICK;
+    if (oneshot_ticks - elapsed > 1)
+        start_oneshot(since % PIT_CYCLES_PER_TICK, 1);
+    else {
+        /* The one-shot already ends at the next tick boundary. */
+        oneshot_phase -= elapsed * PIT_CYCLES_PER_TICK;
+        oneshot_ticks -= elapsed;
+    }
+    advance_ticks(elapsed);
+}
+
 /*! Timer interrupt handler. */
-static void timer_interrupt(struct intr_frame *args UNUSED) {
-    ticks++;
-    thread_tick();
+static void timer_interrupt(struct intr_frame *args) {
+    int64_t n = 1;
+
+    if (oneshot_ticks != 0) {
+        /* A one-shot from timer_enter_idle() expired.  Catch up on the ticks
+           it stood in for and go back to the periodic tick. */
+        n = oneshot_ticks;
+        oneshot_ticks = 0;
+        pit_configure_channel(0, 2, TIMER_FREQ);
+    }
+    profile_tick(args, n);
+    advance_ticks(n);
+}
+
+/*! Advances the tick count by N, doing the per-tick work for each tick, then
+    defers running the timer events that have come due to the timer
+    softirq. */
+static void advance_ticks(int64_t n) {
+    while (n-- > 0) {
+        ticks++;
+        thread_tick();
+    }
+    softirq_raise(SOFTIRQ_TIMER);
+}
+
+/*! Returns true if no timer event is due at TICK, which must lie within the
+    current level 0 window of the wheel. */
+static bool wheel_slot_empty(int64_t tick) {
+    ASSERT(tick >= wheel_ticks && tick - wheel_ticks < WHEEL_SLOTS);
+    return list_empty(&wheel[0][tick & WHEEL_MASK]);
+}
+
+/*! Puts EVENT into the wheel slot for its deadline, relative to
+    wheel_ticks.  Interrupts must be off. */
+static void wheel_insert(struct timer_event *event) {
+    int64_t when = event->deadline;
+    int64_t delta = when - wheel_ticks;
+    int level;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (delta < 0) {
+        /* Already due: run it at the next tick. */
+        when = wheel_ticks;
+        delta = 0;
+    }
+    else if (delta >= WHEEL_SPAN) {
+        /* Too far out for the wheel.  Park it in the coarsest level; it is
+           put back, closer to its real deadline, when that slot cascades. */
+        when = wheel_ticks + WHEEL_SPAN - 1;
+        delta = WHEEL_SPAN - 1;
+    }
+
+    for (level = 0; level < WHEEL_LEVELS - 1; level++) {
+        if (delta < (int64_t) 1 << (WHEEL_BITS * (level + 1)))
+            break;
+    }
+    list_push_back(&wheel[level][(when >> (WHEEL_BITS * level)) & WHEEL_MASK],
+                   &event->elem);
+}
+
+/*! Redistributes the events in the current slot of LEVEL into the finer
+    levels.  If that slot is slot 0, the next coarser level has wrapped
+    around too, so cascades it as well. */
+static void wheel_cascade(int level) {
+    int slot = (wheel_ticks >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    struct list events;
+
+    /* Detach the slot first: wheel_insert() could put an event parked in
+       the coarsest level right back into the same slot. */
+    list_init(&events);
+    while (!list_empty(&wheel[level][slot]))
+        list_push_back(&events, list_pop_front(&wheel[level][slot]));
+    while (!list_empty(&events))
+        wheel_insert(list_entry(list_pop_front(&events),
+                                struct timer_event, elem));
+
+    if (slot == 0 && level + 1 < WHEEL_LEVELS)
+        wheel_cascade(level + 1);
+}
+
+/*! Runs the callbacks of all events that are due as of the current tick.
+    Runs as the timer softirq.  Callbacks run with interrupts off, as
+    before, but interrupts are let in between them, so the time spent with
+    interrupts off does not grow with the number of events due. */
+static void wheel_run(void) {
+    struct list *slot;
+    struct timer_event *event;
+    enum intr_level old_level;
+
+    ASSERT(intr_context());
+
+    old_level = intr_disable();
+    while (wheel_ticks <= ticks) {
+        if ((wheel_ticks & WHEEL_MASK) == 0)
+            wheel_cascade(1);
+
+        slot = &wheel[0][wheel_ticks & WHEEL_MASK];
+        while (!list_empty(slot)) {
+            event = list_entry(list_pop_front(slot), struct timer_event, elem);
+            event->pending = false;
+            event->func(event->aux);
+
+            intr_set_level(old_level);
+            old_level = intr_disable();
+        }
+        wheel_ticks++;
+    }
+    intr_set_level(old_level);
 }
 
 /*! Returns true if LOOPS iterations waits for more than one timer tick,
@@ -176,9 +493,27 @@ static void real_time_sleep(int64_t num, int32_t denom) {
        1 s / TIMER_FREQ ticks
     */
     int64_t ticks = num * TIMER_FREQ / denom;
+    int64_t deadline;
 
     ASSERT(intr_get_level() == INTR_ON);
-    if (ticks > 0) {
+    ASSERT(1000000000 % denom == 0);
+
+    if (tsc_hz != 0) {
+        /* Sleep on the timer wheel until the last tick boundary at or
+           before the deadline, then spin out the rest on the TSC, which is
+           less than a tick.  timer_now_ns() counts from tick boundaries, so
+           that boundary is tick DEADLINE / NS_PER_TICK, wherever in the
+           current tick we start. */
+        int64_t wake_tick;
+
+        deadline = timer_now_ns() + num * (1000000000 / denom);
+        wake_tick = deadline / NS_PER_TICK;
+        if (wake_tick > timer_ticks())
+            thread_sleep(wake_tick);
+        while (timer_now_ns() < deadline)
+            barrier();
+    }
+    else if (ticks > 0) {
         /* We're waiting for at least one full timer tick.  Use timer_sleep()
            because it will yield the CPU to other processes. */                
         timer_sleep(ticks); 
@@ -191,9 +526,87 @@ static void real_time_sleep(int64_t num, int32_t denom) {
 
 /*! Busy-wait for approximately NUM/DENOM seconds. */
 static void real_time_delay(int64_t num, int32_t denom) {
+    int64_t deadline;
+
+    ASSERT(denom % 1000 == 0);
+
+    if (tsc_hz != 0) {
+        deadline = timer_now_ns() + num * (1000000000 / denom);
+        while (timer_now_ns() < deadline)
+            barrier();
+        return;
+    }
+
     /* Scale the numerator and denominator down by 1000 to avoid
        the possibility of overflow. */
-    ASSERT(denom % 1000 == 0);
     busy_wait(loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
 }
 
+/*! Returns true if the CPU has a time-stamp counter. */
+static bool tsc_present(void) {
+    uint32_t flags, toggled, eax, edx;
+
+    /* The CPUID instruction exists if the ID flag can be toggled. */
+    asm volatile ("pushfl\n\t"
+                  "popl %0\n\t"
+                  "movl %0, %1\n\t"
+                  "xorl %2, %1\n\t"
+                  "pushl %1\n\t"
+                  "popfl\n\t"
+                  "pushfl\n\t"
+                  "popl %1\n\t"
+                  "pushl %0\n\t"
+                  "popfl"
+                  : "=&r" (flags), "=&r" (toggled)
+                  : "i" (FLAG_ID)
+                  : "cc");
+    if (((flags ^ toggled) & FLAG_ID) == 0)
+        return false;
+
+    /* CPUID leaf 1 reports the TSC in bit 4 of EDX. */
+    asm volatile ("cpuid" : "=a" (eax), "=d" (edx) : "0" (1) : "ebx", "ecx");
+    return (edx & (1u << 4)) != 0;
+}
+
+/*! Returns the current value of the time-stamp counter. */
+static uint64_t tsc_read(void) {
+    uint64_t tsc;
+
+    asm volatile ("rdtsc" : "=A" (tsc));
+    return tsc;
+}
+
+/*! Measures the TSC rate over TSC_CALIBRATE_TICKS timer ticks and switches
+    timer_now_ns() over to the TSC. */
+static void tsc_calibrate(void) {
+    enum intr_level old_level;
+    int64_t start;
+    uint64_t start_tsc, hz;
+
+    ASSERT(intr_get_level() == INTR_ON);
+
+    if (!tsc_present())
+        return;
+
+    /* Start on a tick boundary. */
+    start = ticks;
+    while (ticks == start)
+        barrier();
+    start = ticks;
+    start_tsc = tsc_read();
+
+    while (ticks < start + TSC_CALIBRATE_TICKS)
+        barrier();
+    hz = (tsc_read() - start_tsc) * TIMER_FREQ / TSC_CALIBRATE_TICKS;
+    if (hz == 0)
+        return;
+
+    /* Interrupt handlers may read the clock, so switch atomically. */
+    old_level = intr_disable();
+    tsc_base = start_tsc;
+    tsc_base_tick = start;
+    tsc_hz = hz;
+    intr_set_level(old_level);
+    printf("Clocksource: TSC at %'"PRIu64" kHz.\n", hz / 1000);
+}
+
@@ -1,18 +1,36 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /*! Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/*! Nanoseconds per timer tick. */
+#define NS_PER_TICK (1000 * 1000 * 1000 / TIMER_FREQ)
+
+/*! If false (default), the timer interrupts TIMER_FREQ times per second.
+    If true, the idle thread stops the periodic tick while it waits, instead
+    programming a single interrupt for the next timer event.  Controlled by
+    kernel command-line option "-tickless". */
+extern bool timer_tickless;
+
 void timer_init(void);
 void timer_calibrate(void);
 
 int64_t timer_ticks(void);
 int64_t timer_elapsed(int64_t);
 
+/* Monotonic clock. */
+int64_t timer_now_ns(void);
+
+/* Dynamic tick. */
+void timer_enter_idle(void);
+void timer_exit_idle(void);
+
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep(int64_t ticks);
 void timer_msleep(int64_t milliseconds);
@@ -26,5 +44,26 @@ void timer_ndelay(int64_t nanoseconds);
 
 void timer_print_stats(void);
 
+/*! A function called by the timer when a timed event expires, passed the
+    AUX given to timer_add().  It runs in the timer interrupt handler, so it
+    must not sleep and should be brief; it may call intr_yield_on_return(). */
+typedef void timer_callback_func(void *aux);
+
+/*! A timed event (callout).  Embed one in the structure that owns it, so that
+    scheduling it never allocates memory.  Owned by timer.c between
+    timer_add() and expiry or timer_cancel(). */
+struct timer_event {
+    int64_t deadline;                   /*!< Tick at which to fire. */
+    timer_callback_func *func;          /*!< Function to call. */
+    void *aux;                          /*!< Argument for FUNC. */
+    bool pending;                       /*!< Scheduled and not yet fired? */
+    struct list_elem elem;              /*!< Timer wheel slot element. */
+};
+
+/* Timed callbacks. */
+void timer_add(struct timer_event *, int64_t deadline,
+               timer_callback_func *, void *aux);
+bool timer_cancel(struct timer_event *);
+
 #endif /* devices/timer.h */
 
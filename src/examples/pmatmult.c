@@ -0,0 +1,73 @@
+/* pmatmult.c
+
+   Like matmult.c, but splits the rows of the product among
+   several threads of one process.  A mutex-protected counter
+   hands out rows, so threads that run more take more of them. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include <uthread.h>
+
+#define DIM 128
+#define THREADS 4
+#define STACK_SIZE 4096
+
+int A[DIM][DIM];
+int B[DIM][DIM];
+int C[DIM][DIM];
+
+static char stacks[THREADS][STACK_SIZE];
+static struct umutex row_lock = UMUTEX_INITIALIZER;
+static int next_row;
+
+/* Multiplies rows until there are none left.  Returns the
+   number of rows done. */
+static int
+worker (void *aux UNUSED)
+{
+  int done = 0;
+
+  for (;;)
+    {
+      int i, j, k;
+
+      umutex_lock (&row_lock);
+      i = next_row++;
+      umutex_unlock (&row_lock);
+      if (i >= DIM)
+        return done;
+
+      for (j = 0; j < DIM; j++)
+        for (k = 0; k < DIM; k++)
+          C[i][j] += A[i][k] * B[k][j];
+      done++;
+    }
+}
+
+int
+main (void)
+{
+  pid_t tids[THREADS];
+  int i, j, rows;
+
+  /* Initialize the matrices. */
+  for (i = 0; i < DIM; i++)
+    for (j = 0; j < DIM; j++)
+      {
+	A[i][j] = i;
+	B[i][j] = j;
+	C[i][j] = 0;
+      }
+
+  /* Multiply matrices. */
+  for (i = 0; i < THREADS; i++)
+    tids[i] = uthread_create (worker, NULL, stacks[i], STACK_SIZE);
+  rows = worker (NULL);
+  for (i = 0; i < THREADS; i++)
+    if (tids[i] != PID_ERROR)
+      rows += uthread_join (tids[i]);
+  printf ("pmatmult: %d rows computed by %d threads\n", rows, THREADS + 1);
+
+  /* Done. */
+  exit (C[DIM - 1][DIM - 1]);
+}
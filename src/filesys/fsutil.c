@@ -144,6 +144,29 @@ void fsutil_extract(char **argv UNUSED) {
     free(header);
 }
 
+/*! Sector at which the next file appended to the ustar archive on the
+    scratch device begins. */
+static block_sector_t append_sector;
+
+/*! Writes a ustar header for a SIZE-byte FILE_NAME to DST at
+    APPEND_SECTOR, using BUFFER as scratch space. */
+static void append_header(struct block *dst, const char *file_name,
+                          off_t size, void *buffer) {
+    if (!ustar_make_header(file_name, USTAR_REGULAR, size, buffer))
+        PANIC("%s: name too long for ustar format", file_name);
+    block_write(dst, append_sector++, buffer);
+}
+
+/*! Writes the ustar end-of-archive marker, which is two consecutive
+    sectors full of zeros, to DST using BUFFER as scratch space.  Doesn't
+    advance APPEND_SECTOR past them, in case more files are appended. */
+static void append_end(struct block *dst, void *buffer) {
+    memset(buffer, 0, BLOCK_SECTOR_SIZE);
+    block_write(dst, append_sector, buffer);
+    if (append_sector + 1 < block_size(dst))
+        block_write(dst, append_sector + 1, buffer);
+}
+
 /*! Copies file FILE_NAME from the file system to the scratch device, in ustar
     format.
 
@@ -152,8 +175,6 @@ void fsutil_extract(char **argv UNUSED) {
     independent of that used for fsutil_extract(), so `extract' should precede
     all `append's. */
 void fsutil_append(char **argv) {
-    static block_sector_t sector = 0;
-
     const char *file_name = argv[1];
     void *buffer;
     struct file *src;
@@ -179,31 +200,57 @@ void fsutil_append(char **argv) {
         PANIC("couldn't open scratch device");
   
     /* Write ustar header to first sector. */
-    if (!ustar_make_header(file_name, USTAR_REGULAR, size, buffer))
-        PANIC("%s: name too long for ustar format", file_name);
-    block_write(dst, sector++, buffer);
+    append_header(dst, file_name, size, buffer);
 
     /* Do copy. */
     while (size > 0) {
         int chunk_size = size > BLOCK_SECTOR_SIZE ? BLOCK_SECTOR_SIZE : size;
-        if (sector >= block_size(dst))
+        if (append_sector >= block_size(dst))
             PANIC("%s: out of space on scratch device", file_name);
         if (file_read(src, buffer, chunk_size) != chunk_size)
             PANIC("%s: read failed with %"PROTd" bytes unread", file_name, size);
         memset(buffer + chunk_size, 0, BLOCK_SECTOR_SIZE - chunk_size);
-        block_write(dst, sector++, buffer);
+        block_write(dst, append_sector++, buffer);
         size -= chunk_size;
     }
 
-    /* Write ustar end-of-archive marker, which is two consecutive
-       sectors full of zeros.  Don't advance our position past
-       them, though, in case we have more files to append. */
-    memset(buffer, 0, BLOCK_SECTOR_SIZE);
-    block_write(dst, sector, buffer);
-    block_write(dst, sector, buffer + 1);
+    append_end(dst, buffer);
 
     /* Finish up. */
     file_close(src);
     free(buffer);
 }
 
+/*! Appends the SIZE bytes at DATA to the ustar archive on the scratch
+    device as FILE_NAME, after any files appended by fsutil_append(). */
+void fsutil_append_buffer(const char *file_name, const void *data,
+                          off_t size) {
+    const uint8_t *src = data;
+    void *buffer;
+    struct block *dst;
+
+    buffer = malloc(BLOCK_SECTOR_SIZE);
+    if (buffer == NULL)
+        PANIC("couldn't allocate buffer");
+
+    dst = block_get_role(BLOCK_SCRATCH);
+    if (dst == NULL)
+        PANIC("couldn't open scratch device");
+
+    append_header(dst, file_name, size, buffer);
+
+    while (size > 0) {
+        int chunk_size = size > BLOCK_SECTOR_SIZE ? BLOCK_SECTOR_SIZE : size;
+        if (append_sector >= block_size(dst))
+            PANIC("%s: out of space on scratch device", file_name);
+        memcpy(buffer, src, chunk_size);
+        memset(buffer + chunk_size, 0, BLOCK_SECTOR_SIZE - chunk_size);
+        block_write(dst, append_sector++, buffer);
+        src += chunk_size;
+        size -= chunk_size;
+    }
+
+    append_end(dst, buffer);
+    free(buffer);
+}
+
@@ -0,0 +1,21 @@
+/*! \file cpugroup.h
+ *
+ * CPU bandwidth group statistics, as returned to user programs by the
+ * cpugroup_stat() system call.
+ */
+
+#ifndef __LIB_CPUGROUP_H
+#define __LIB_CPUGROUP_H
+
+#include <stdint.h>
+
+/*! Usage of one CPU bandwidth group.  Times are in timer ticks. */
+struct cpugroup_stat {
+    int64_t quota;                  /*!< CPU time allowed per period. */
+    int64_t period;                 /*!< Length of a period. */
+    int64_t usage;                  /*!< CPU time used since creation. */
+    unsigned throttled_periods;     /*!< Periods in which the quota ran out. */
+    unsigned nr_threads;            /*!< Threads in the group. */
+};
+
+#endif /* lib/cpugroup.h */
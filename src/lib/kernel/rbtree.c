@@ -0,0 +1,359 @@
+/* Red-black tree.
+
+   The algorithms are those of Cormen, Leiserson, Rivest and
+   Stein, "Introduction to Algorithms", chapter 13, adapted to
+   use null pointers rather than a sentinel for the leaves.
+
+   See rbtree.h for basic information. */
+
+#include "rbtree.h"
+#include "../debug.h"
+
+static void rotate_left (struct rb_tree *, struct rb_node *);
+static void rotate_right (struct rb_tree *, struct rb_node *);
+static void transplant (struct rb_tree *, struct rb_node *,
+                        struct rb_node *);
+static void insert_fixup (struct rb_tree *, struct rb_node *);
+static void remove_fixup (struct rb_tree *, struct rb_node *,
+                          struct rb_node *);
+
+/* Returns true if node N is red.  Null leaves are black. */
+static inline bool
+is_red (const struct rb_node *n) 
+{
+  return n != NULL && n->red;
+}
+
+/* Returns the least node in the subtree rooted at N. */
+static struct rb_node *
+subtree_min (struct rb_node *n) 
+{
+  while (n->left != NULL)
+    n = n->left;
+  return n;
+}
+
+/* Initializes TREE as an empty tree that orders its nodes with
+   LESS, which is passed auxiliary data AUX. */
+void
+rb_init (struct rb_tree *tree, rb_less_func *less, void *aux) 
+{
+  ASSERT (tree != NULL);
+  ASSERT (less != NULL);
+
+  tree->root = NULL;
+  tree->leftmost = NULL;
+  tree->size = 0;
+  tree->less = less;
+  tree->aux = aux;
+}
+
+/* Inserts NODE into TREE, after any nodes that compare equal to
+   it. */
+void
+rb_insert (struct rb_tree *tree, struct rb_node *node) 
+{
+  struct rb_node **link = &tree->root;
+  struct rb_node *parent = NULL;
+  bool leftmost = true;
+
+  ASSERT (tree != NULL);
+  ASSERT (node != NULL);
+
+  while (*link != NULL) 
+    {
+      parent = *link;
+      if (tree->less (node, parent, tree->aux))
+        link = &parent->left;
+      else 
+        {
+          link = &parent->right;
+          leftmost = false;
+        }
+    }
+
+  node->parent = parent;
+  node->left = node->right = NULL;
+  node->red = true;
+  *link = node;
+  if (leftmost)
+    tree->leftmost = node;
+  tree->size++;
+
+  insert_fixup (tree, node);
+}
+
+/* Removes NODE, which must be in TREE, from TREE. */
+void
+rb_remove (struct rb_tree *tree, struct rb_node *node) 
+{
+  struct rb_node *moved = node;     /* Node removed from its place. */
+  struct rb_node *child;            /* Node that took moved's place. */
+  struct rb_node *child_parent;     /* Parent of that place. */
+  bool moved_red = node->red;
+
+  ASSERT (tree != NULL);
+  ASSERT (node != NULL);
+  ASSERT (tree->size > 0);
+
+  if (tree->leftmost == node)
+    tree->leftmost = rb_next (node);
+
+  if (node->left == NULL) 
+    {
+      child = node->right;
+      child_parent = node->parent;
+      transplant (tree, node, node->right);
+    }
+  else if (node->right == NULL) 
+    {
+      child = node->left;
+      child_parent = node->parent;
+      transplant (tree, node, node->left);
+    }
+  else 
+    {
+      /* Replace NODE by its successor, which has no left child. */
+      moved = subtree_min (node->right);
+      moved_red = moved->red;
+      child = moved->right;
+      if (moved->parent == node)
+        child_parent = moved;
+      else 
+        {
+          child_parent = moved->parent;
+          transplant (tree, moved, moved->right);
+          moved->right = node->right;
+          moved->right->parent = moved;
+        }
+      transplant (tree, node, moved);
+      moved->left = node->left;
+      moved->left->parent = moved;
+      moved->red = node->red;
+    }
+  tree->size--;
+
+  if (!moved_red)
+    remove_fixup (tree, child, child_parent);
+}
+
+/* Returns the least node in TREE, or a null pointer if TREE is
+   empty. */
+struct rb_node *
+rb_first (const struct rb_tree *tree) 
+{
+  return tree->leftmost;
+}
+
+/* Returns the node after NODE in its tree, or a null pointer if
+   NODE is the greatest. */
+struct rb_node *
+rb_next (struct rb_node *node) 
+{
+  struct rb_node *parent;
+
+  if (node->right != NULL)
+    return subtree_min (node->right);
+
+  parent = node->parent;
+  while (parent != NULL && node == parent->right) 
+    {
+      node = parent;
+      parent = parent->parent;
+    }
+  return parent;
+}
+
+/* Returns the number of nodes in TREE. */
+size_t
+rb_size (const struct rb_tree *tree) 
+{
+  return tree->size;
+}
+
+/* Returns true if TREE is empty, false otherwise. */
+bool
+rb_empty (const struct rb_tree *tree) 
+{
+  return tree->root == NULL;
+}
+
+/* Rotates the subtree rooted at X to the left, making X's right
+   child its parent. */
+static void
+rotate_left (struct rb_tree *tree, struct rb_node *x) 
+{
+  struct rb_node *y = x->right;
+
+  x->right = y->left;
+  if (y->left != NULL)
+    y->left->parent = x;
+  transplant (tree, x, y);
+  y->left = x;
+  x->parent = y;
+}
+
+/* Rotates the subtree rooted at X to the right, making X's left
+   child its parent. */
+static void
+rotate_right (struct rb_tree *tree, struct rb_node *x) 
+{
+  struct rb_node *y = x->left;
+
+  x->left = y->right;
+  if (y->right != NULL)
+    y->right->parent = x;
+  transplant (tree, x, y);
+  y->right = x;
+  x->parent = y;
+}
+
+/* Puts V, which may be null, in U's place under U's parent.
+   Leaves U's own children alone. */
+static void
+transplant (struct rb_tree *tree, struct rb_node *u, struct rb_node *v) 
+{
+  if (u->parent == NULL)
+    tree->root = v;
+  else if (u == u->parent->left)
+    u->parent->left = v;
+  else
+    u->parent->right = v;
+  if (v != NULL)
+    v->parent = u->parent;
+}
+
+/* Restores the red-black properties after inserting red node
+   NODE. */
+static void
+insert_fixup (struct rb_tree *tree, struct rb_node *node) 
+{
+  struct rb_node *parent, *grandparent, *uncle;
+
+  while (is_red (parent = node->parent)) 
+    {
+      /* A red node is never the root, so GRANDPARENT exists. */
+      grandparent = parent->parent;
+      if (parent == grandparent->left) 
+        {
+          uncle = grandparent->right;
+          if (is_red (uncle)) 
+            {
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              node = grandparent;
+              continue;
+            }
+          if (node == parent->right) 
+            {
+              rotate_left (tree, parent);
+              node = parent;
+              parent = node->parent;
+            }
+          parent->red = false;
+          grandparent->red = true;
+          rotate_right (tree, grandparent);
+        }
+      else 
+        {
+          uncle = grandparent->left;
+          if (is_red (uncle)) 
+            {
+              parent->red = uncle->red = false;
+              grandparent->red = true;
+              node = grandparent;
+              continue;
+            }
+          if (node == parent->left) 
+            {
+              rotate_right (tree, parent);
+              node = parent;
+              parent = node->parent;
+            }
+          parent->red = false;
+          grandparent->red = true;
+          rotate_left (tree, grandparent);
+        }
+    }
+  tree->root->red = false;
+}
+
+/* Restores the red-black properties after removing a black node
+   whose place was taken by NODE, which may be null, under
+   PARENT. */
+static void
+remove_fixup (struct rb_tree *tree, struct rb_node *node,
+              struct rb_node *parent) 
+{
+  struct rb_node *sibling;
+
+  while (node != tree->root && !is_red (node)) 
+    {
+      if (node == parent->left) 
+        {
+          sibling = parent->right;
+          if (is_red (sibling)) 
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_left (tree, parent);
+              sibling = parent->right;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right)) 
+            {
+              sibling->red = true;
+              node = parent;
+              parent = node->parent;
+            }
+          else 
+            {
+              if (!is_red (sibling->right)) 
+                {
+                  sibling->left->red = false;
+                  sibling->red = true;
+                  rotate_right (tree, sibling);
+                  sibling = parent->right;
+                }
+              sibling->red = parent->red;
+              parent->red = false;
+              sibling->right->red = false;
+              rotate_left (tree, parent);
+              node = tree->root;
+            }
+        }
+      else 
+        {
+          sibling = parent->left;
+          if (is_red (sibling)) 
+            {
+              sibling->red = false;
+              parent->red = true;
+              rotate_right (tree, parent);
+              sibling = parent->left;
+            }
+          if (!is_red (sibling->left) && !is_red (sibling->right)) 
+            {
+              sibling->red = true;
+              node = parent;
+              parent = node->parent;
+            }
+          else 
+            {
+              if (!is_red (sibling->left)) 
+                {
+                  sibling->right->red = false;
+                  sibling->red = true;
+                  rotate_left (tree, sibling);
+                  sibling = parent->left;
+                }
+              sibling->red = parent->red;
+              parent->red = false;
+              sibling->left->red = false;
+              rotate_right (tree, parent);
+              node = tree->root;
+            }
+        }
+    }
+  if (node != NULL)
+    node->red = false;
+}
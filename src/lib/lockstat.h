@@ -0,0 +1,26 @@
+/*! \file lockstat.h
+ *
+ * Lock contention statistics, as kept by the kernel for each lock class and
+ * returned to user programs by the lockstat() system call.
+ */
+
+#ifndef __LIB_LOCKSTAT_H
+#define __LIB_LOCKSTAT_H
+
+#include <stdint.h>
+
+/*! Maximum length of a lock class name, including the null terminator. */
+#define LOCKSTAT_NAME_MAX 24
+
+/*! Contention statistics for one lock class, that is, for every lock or
+    semaphore initialized under the same name.  Times are in nanoseconds. */
+struct lockstat {
+    char name[LOCKSTAT_NAME_MAX];   /*!< Class name. */
+    unsigned acquisitions;          /*!< Successful acquisitions. */
+    unsigned contended;             /*!< Acquisitions that had to wait. */
+    int64_t wait_total;             /*!< Total time spent waiting. */
+    int64_t wait_max;               /*!< Longest single wait. */
+    int64_t hold_total;             /*!< Total time held (locks only). */
+};
+
+#endif /* lib/lockstat.h */
@@ -0,0 +1,30 @@
+/*! \file schedstat.h
+ *
+ * Scheduler statistics, as kept by the kernel for each thread and returned
+ * to user programs by the schedstat() system call.
+ */
+
+#ifndef __LIB_SCHEDSTAT_H
+#define __LIB_SCHEDSTAT_H
+
+#include <stdint.h>
+
+/*! Number of buckets in a wakeup latency histogram.  Bucket 0 counts
+    wakeups that ran within a microsecond, bucket N (N > 0) those that
+    waited between 2**(N-1) and 2**N - 1 microseconds, and the last bucket
+    also counts everything longer. */
+#define SCHEDSTAT_BUCKETS 16
+
+/*! Scheduler statistics for one thread, or for the whole system. */
+struct schedstat {
+    unsigned voluntary_switches;    /*!< Gave up the CPU by blocking. */
+    unsigned involuntary_switches;  /*!< Preempted or yielded while ready. */
+    int64_t run_ns;                 /*!< Nanoseconds spent running. */
+    int64_t wait_ns;                /*!< Nanoseconds spent ready, waiting
+                                         for the CPU. */
+    unsigned latency_hist[SCHEDSTAT_BUCKETS]; /*!< Wakeup-to-run latency. */
+    unsigned deadline_misses;       /*!< EDF jobs still unfinished at
+                                         their deadline. */
+};
+
+#endif /* lib/schedstat.h */
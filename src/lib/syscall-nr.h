@@ -34,7 +34,21 @@ enum {
     SYS_MKDIR,                  /*!< Create a directory. */
     SYS_READDIR,                /*!< Reads a directory entry. */
     SYS_ISDIR,                  /*!< Tests if a fd represents a directory. */
-    SYS_INUMBER                 /*!< Returns the inode number for a fd. */
+    SYS_INUMBER,                /*!< Returns the inode number for a fd. */
+
+    /* Scheduler instrumentation. */
+    SYS_SCHEDSTAT,              /*!< Get a process's scheduler statistics. */
+    SYS_LOCKSTAT,               /*!< Get the most contended lock classes. */
+    SYS_SCHED_SETDEADLINE,      /*!< Join or leave the EDF class. */
+    SYS_CPUGROUP_CREATE,        /*!< Start a CPU bandwidth group. */
+    SYS_CPUGROUP_STAT,          /*!< Get a CPU bandwidth group's usage. */
+
+    /* User-level threads. */
+    SYS_UTHREAD_SPAWN,          /*!< Start a thread in this process. */
+    SYS_UTHREAD_JOIN,           /*!< Wait for a thread of this process. */
+    SYS_UTHREAD_DETACH,         /*!< Let a thread go without a join. */
+    SYS_FUTEX_WAIT,             /*!< Sleep on a user address. */
+    SYS_FUTEX_WAKE              /*!< Wake sleepers on a user address. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -153,3 +153,43 @@ int inumber(int fd) {
     return syscall1(SYS_INUMBER, fd);
 }
 
+bool schedstat(pid_t pid, struct schedstat *stats) {
+    return syscall2(SYS_SCHEDSTAT, pid, stats);
+}
+
+int lockstat(struct lockstat *stats, int max) {
+    return syscall2(SYS_LOCKSTAT, stats, max);
+}
+
+bool sched_setdeadline(unsigned runtime, unsigned deadline, unsigned period) {
+    return syscall3(SYS_SCHED_SETDEADLINE, runtime, deadline, period);
+}
+
+int cpugroup_create(unsigned quota, unsigned period) {
+    return syscall2(SYS_CPUGROUP_CREATE, quota, period);
+}
+
+bool cpugroup_stat(int group, struct cpugroup_stat *stat) {
+    return syscall2(SYS_CPUGROUP_STAT, group, stat);
+}
+
+pid_t uthread_spawn(void (*eip)(void), void *esp) {
+    return syscall2(SYS_UTHREAD_SPAWN, eip, esp);
+}
+
+int uthread_join(pid_t tid) {
+    return syscall1(SYS_UTHREAD_JOIN, tid);
+}
+
+int uthread_detach(pid_t tid) {
+    return syscall1(SYS_UTHREAD_DETACH, tid);
+}
+
+int futex_wait(int *addr, int val) {
+    return syscall2(SYS_FUTEX_WAIT, addr, val);
+}
+
+int futex_wake(int *addr, int count) {
+    return syscall2(SYS_FUTEX_WAKE, addr, count);
+}
+
@@ -2,7 +2,10 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <cpugroup.h>
 #include <debug.h>
+#include <lockstat.h>
+#include <schedstat.h>
 
 /*! Process identifier. */
 typedef int pid_t;
@@ -45,5 +48,19 @@ bool readdir(int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir(int fd);
 int inumber(int fd);
 
+/* Scheduler instrumentation. */
+bool schedstat(pid_t, struct schedstat *);
+int lockstat(struct lockstat *, int max);
+bool sched_setdeadline(unsigned runtime, unsigned deadline, unsigned period);
+int cpugroup_create(unsigned quota, unsigned period);
+bool cpugroup_stat(int group, struct cpugroup_stat *);
+
+/* User-level threads; see also <uthread.h>. */
+pid_t uthread_spawn(void (*eip)(void), void *esp);
+int uthread_join(pid_t);
+int uthread_detach(pid_t);
+int futex_wait(int *addr, int val);
+int futex_wake(int *addr, int count);
+
 #endif /* lib/user/syscall.h */
 
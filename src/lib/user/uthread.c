@@ -0,0 +1,85 @@
+/*! \file uthread.c
+ *
+ * User-level threads and futex-based mutexes.  Threads run in the calling
+ * process on a stack supplied by the caller.  The mutex follows the usual
+ * three-state futex protocol, so an uncontended lock or unlock is a single
+ * atomic instruction and never makes a system call.
+ */
+
+#include <uthread.h>
+#include <stdint.h>
+
+/*! Atomically stores NEW into *P if it holds OLD, and returns the value
+    *P held before. */
+static inline int cmpxchg(int *p, int old, int new) {
+    int prev;
+
+    asm volatile ("lock cmpxchgl %2, %1"
+                  : "=a" (prev), "+m" (*p)
+                  : "r" (new), "0" (old)
+                  : "memory");
+    return prev;
+}
+
+/*! Atomically stores V into *P and returns the value *P held before. */
+static inline int xchg(int *p, int v) {
+    asm volatile ("xchgl %0, %1" : "+r" (v), "+m" (*p) : : "memory");
+    return v;
+}
+
+/*! First code a new thread runs.  Calls FUNCTION(AUX) and exits with its
+    return value. */
+static void NO_RETURN uthread_start(uthread_func *function, void *aux) {
+    exit(function(aux));
+}
+
+/*! Starts a new thread in this process running FUNCTION(AUX) on the SIZE
+    bytes of STACK, which must stay allocated until the thread exits.
+    Returns the thread's id, to pass to uthread_join() or uthread_detach(),
+    or PID_ERROR. */
+pid_t uthread_create(uthread_func *function, void *aux, void *stack,
+                     size_t size) {
+    uintptr_t top = ((uintptr_t) stack + size) & ~(uintptr_t) 0xf;
+    void **sp = (void **) top - 2;
+
+    /* Lay out a call frame for uthread_start(FUNCTION, AUX), with a null
+       return address, leaving the stack 16-byte aligned at the call. */
+    *--sp = aux;
+    *--sp = function;
+    *--sp = NULL;
+
+    return uthread_spawn((void (*)(void)) uthread_start, sp);
+}
+
+/*! Initializes MUTEX as unlocked. */
+void umutex_init(struct umutex *mutex) {
+    mutex->state = 0;
+}
+
+/*! Acquires MUTEX, sleeping in the kernel while another thread holds it. */
+void umutex_lock(struct umutex *mutex) {
+    int state = cmpxchg(&mutex->state, 0, 1);
+
+    if (state == 0)
+        return;
+
+    /* Mark the mutex contended, then sleep until it is handed over. */
+    if (state != 2)
+        state = xchg(&mutex->state, 2);
+    while (state != 0) {
+        futex_wait(&mutex->state, 2);
+        state = xchg(&mutex->state, 2);
+    }
+}
+
+/*! Acquires MUTEX if it is free, without sleeping.  Returns true on
+    success. */
+bool umutex_trylock(struct umutex *mutex) {
+    return cmpxchg(&mutex->state, 0, 1) == 0;
+}
+
+/*! Releases MUTEX, waking one sleeper if there may be any. */
+void umutex_unlock(struct umutex *mutex) {
+    if (xchg(&mutex->state, 0) == 2)
+        futex_wake(&mutex->state, 1);
+}
@@ -0,0 +1,27 @@
+#ifndef __LIB_USER_UTHREAD_H
+#define __LIB_USER_UTHREAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <syscall.h>
+
+/*! A thread function.  Its return value becomes the thread's exit status,
+    as if passed to exit(). */
+typedef int uthread_func(void *aux);
+
+pid_t uthread_create(uthread_func *, void *aux, void *stack, size_t size);
+
+/*! A mutex that only enters the kernel when contended.  STATE is 0 when
+    unlocked, 1 when locked, and 2 when locked with possible sleepers. */
+struct umutex {
+    int state;
+};
+
+#define UMUTEX_INITIALIZER { 0 }
+
+void umutex_init(struct umutex *);
+void umutex_lock(struct umutex *);
+bool umutex_trylock(struct umutex *);
+void umutex_unlock(struct umutex *);
+
+#endif /* lib/user/uthread.h */
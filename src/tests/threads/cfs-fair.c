@@ -0,0 +1,118 @@
+/* Measures the fairness of the completely fair scheduler.
+
+   The cfs-fair-3 test runs 3 threads niced to 0, which should
+   each receive about the same number of ticks.  The cfs-nice-3
+   test runs threads with nice 0, 5 and 10, which should share
+   the CPU in proportion to their weights, 1024 : 335 : 110.
+   Each of these spins for 20 seconds, so the ticks should sum
+   to about 20 * 100 == 2000 ticks.
+
+   The cfs-sleeper test runs 2 threads with nice 0.  The second
+   sleeps for the first 10 seconds, while the first runs alone
+   and its vruntime grows, and then both spin for 10 seconds.
+   The sleeper's vruntime is raised toward the other's when it
+   wakes, so it must not get to monopolize the CPU: over those
+   10 seconds each should receive about 500 ticks. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static void test_cfs_fair (int thread_cnt, int nice_step, bool sleeper);
+
+void
+test_cfs_fair_3 (void) 
+{
+  test_cfs_fair (3, 0, false);
+}
+
+void
+test_cfs_nice_3 (void) 
+{
+  test_cfs_fair (3, 5, false);
+}
+
+void
+test_cfs_sleeper (void) 
+{
+  test_cfs_fair (2, 0, true);
+}
+
+#define MAX_THREAD_CNT 3
+
+struct thread_info 
+  {
+    int64_t start_time;
+    int64_t spin_start;         /* Ticks after START_TIME to start spinning. */
+    int64_t count_start;        /* Ticks after START_TIME to start counting. */
+    int tick_count;
+    int nice;
+  };
+
+static void load_thread (void *aux);
+
+static void
+test_cfs_fair (int thread_cnt, int nice_step, bool sleeper)
+{
+  struct thread_info info[MAX_THREAD_CNT];
+  int64_t start_time;
+  int i;
+
+  ASSERT (thread_cfs);
+  ASSERT (thread_cnt <= MAX_THREAD_CNT);
+
+  thread_set_nice (-20);
+
+  start_time = timer_ticks ();
+  msg ("Starting %d threads...", thread_cnt);
+  for (i = 0; i < thread_cnt; i++) 
+    {
+      struct thread_info *ti = &info[i];
+      char name[16];
+
+      ti->start_time = start_time;
+      ti->spin_start = 2 * TIMER_FREQ;
+      ti->count_start = 2 * TIMER_FREQ;
+      if (sleeper) 
+        {
+          ti->count_start = 12 * TIMER_FREQ;
+          if (i == thread_cnt - 1)
+            ti->spin_start = ti->count_start;
+        }
+      ti->tick_count = 0;
+      ti->nice = i * nice_step;
+
+      snprintf (name, sizeof name, "load %d", i);
+      thread_create (name, PRI_DEFAULT, load_thread, ti);
+    }
+  msg ("Starting threads took %"PRId64" ticks.", timer_elapsed (start_time));
+
+  msg ("Sleeping 25 seconds to let threads run, please wait...");
+  timer_sleep (25 * TIMER_FREQ);
+  
+  for (i = 0; i < thread_cnt; i++)
+    msg ("Thread %d received %d ticks.", i, info[i].tick_count);
+}
+
+static void
+load_thread (void *ti_) 
+{
+  struct thread_info *ti = ti_;
+  int64_t spin_time = 22 * TIMER_FREQ;
+  int64_t last_time = 0;
+
+  thread_set_nice (ti->nice);
+  timer_sleep (ti->spin_start - timer_elapsed (ti->start_time));
+  while (timer_elapsed (ti->start_time) < spin_time) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time
+          && timer_elapsed (ti->start_time) >= ti->count_start)
+        ti->tick_count++;
+      last_time = cur_time;
+    }
+}
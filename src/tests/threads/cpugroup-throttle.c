@@ -0,0 +1,66 @@
+/* A thread in a CPU bandwidth group with a quota of QUOTA ticks
+   per PERIOD ticks spins for PERIOD_CNT periods.  Nothing else
+   wants the CPU, so without throttling it would use all of it;
+   with throttling it must get about QUOTA ticks per period, and
+   the quota must have run out in nearly every period. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/cpugroup.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define QUOTA 2
+#define PERIOD 10
+#define PERIOD_CNT 10
+
+static struct semaphore done;
+
+static thread_func hog_thread_func;
+
+void
+test_cpugroup_throttle (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  thread_create ("hog", PRI_DEFAULT, hog_thread_func, NULL);
+  sema_down (&done);
+}
+
+static void
+hog_thread_func (void *aux UNUSED) 
+{
+  struct cpugroup_stat stat;
+  int64_t start;
+  int id;
+
+  id = cpugroup_new (QUOTA, PERIOD);
+  if (id < 0)
+    fail ("cpugroup_new failed");
+  msg ("hog: spinning for %d periods", PERIOD_CNT);
+
+  start = timer_ticks ();
+  while (timer_elapsed (start) < PERIOD * PERIOD_CNT)
+    continue;
+
+  if (!cpugroup_get_stat (id, &stat))
+    fail ("cpugroup_get_stat failed");
+  if (stat.quota != QUOTA || stat.period != PERIOD || stat.nr_threads != 1)
+    fail ("group has quota %lld, period %lld, %u threads",
+          stat.quota, stat.period, stat.nr_threads);
+  if (stat.usage < (PERIOD_CNT - 1) * QUOTA
+      || stat.usage > (PERIOD_CNT + 1) * (QUOTA + 1))
+    fail ("hog used %lld ticks in %d periods of %d ticks each",
+          stat.usage, PERIOD_CNT, QUOTA);
+  msg ("hog: usage within quota");
+  if (stat.throttled_periods < PERIOD_CNT - 1)
+    fail ("hog throttled in only %u of %d periods",
+          stat.throttled_periods, PERIOD_CNT);
+  msg ("hog: throttled in each period");
+
+  sema_up (&done);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(cpugroup-throttle) begin
+(cpugroup-throttle) hog: spinning for 10 periods
+(cpugroup-throttle) hog: usage within quota
+(cpugroup-throttle) hog: throttled in each period
+(cpugroup-throttle) end
+EOF
+pass;
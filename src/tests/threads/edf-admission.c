@@ -0,0 +1,80 @@
+/* Checks EDF admission control.  Two threads each reserve 40% of
+   the CPU and stay in the EDF class while they sleep.  A third
+   thread then asks for 20%, which would take the total above the
+   90% limit and must be refused, but 10% must still be granted.
+   Parameters that are not 0 < runtime <= deadline <= period must
+   be refused too.  Once the first two leave the EDF class, their
+   bandwidth must be available again. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static struct semaphore hold;
+
+static thread_func reserve_thread_func;
+static thread_func probe_thread_func;
+static bool try_edf (const char *name, int64_t runtime, int64_t deadline,
+                     int64_t period);
+
+void
+test_edf_admission (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&hold, 0);
+  thread_create ("A", PRI_DEFAULT + 1, reserve_thread_func, NULL);
+  thread_create ("B", PRI_DEFAULT + 1, reserve_thread_func, NULL);
+  thread_create ("C", PRI_DEFAULT + 1, probe_thread_func, NULL);
+
+  msg ("main: waking A and B");
+  sema_up (&hold);
+  sema_up (&hold);
+
+  try_edf ("main", 9, 10, 10);
+  try_edf ("main", 0, 0, 0);
+}
+
+/* Reserves 40% of the CPU, then sleeps until the main thread
+   wakes it and leaves the EDF class. */
+static void
+reserve_thread_func (void *aux UNUSED) 
+{
+  const char *name = thread_name ();
+
+  try_edf (name, 4, 10, 10);
+  sema_down (&hold);
+  try_edf (name, 0, 0, 0);
+}
+
+/* Probes the limit while A and B hold 80% of the CPU. */
+static void
+probe_thread_func (void *aux UNUSED) 
+{
+  try_edf ("C", 2, 10, 10);
+  try_edf ("C", 2, 1, 10);
+  try_edf ("C", 1, 10, 5);
+  try_edf ("C", 1, 10, 10);
+  try_edf ("C", 0, 0, 0);
+}
+
+/* Calls thread_set_edf() for the current thread, named NAME,
+   and reports the outcome. */
+static bool
+try_edf (const char *name, int64_t runtime, int64_t deadline, int64_t period) 
+{
+  bool ok = thread_set_edf (runtime, deadline, period);
+
+  if (runtime == 0)
+    msg ("%s: leave EDF: %s", name, ok ? "ok" : "refused");
+  else
+    msg ("%s: runtime %lld, deadline %lld, period %lld: %s", name,
+         runtime, deadline, period, ok ? "admitted" : "refused");
+  return ok;
+}
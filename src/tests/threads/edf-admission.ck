@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-admission) begin
+(edf-admission) A: runtime 4, deadline 10, period 10: admitted
+(edf-admission) B: runtime 4, deadline 10, period 10: admitted
+(edf-admission) C: runtime 2, deadline 10, period 10: refused
+(edf-admission) C: runtime 2, deadline 1, period 10: refused
+(edf-admission) C: runtime 1, deadline 10, period 5: refused
+(edf-admission) C: runtime 1, deadline 10, period 10: admitted
+(edf-admission) C: leave EDF: ok
+(edf-admission) main: waking A and B
+(edf-admission) A: leave EDF: ok
+(edf-admission) B: leave EDF: ok
+(edf-admission) main: runtime 9, deadline 10, period 10: admitted
+(edf-admission) main: leave EDF: ok
+(edf-admission) end
+EOF
+pass;
@@ -0,0 +1,72 @@
+/* Checks that the once-per-second recent_cpu decay reaches
+   threads that are waiting on the run queue, not just the
+   running thread.
+
+   A "hot" thread with nice 0 spins for about 90 ticks, which
+   drops its priority to about 40.  A "niced" thread with nice 10
+   and no recent_cpu sits at priority 43.  The main thread, at
+   nice -20, then spins across two decays while both threads are
+   ready.  The decays shrink the hot thread's recent_cpu nearly to
+   zero, so when the main thread finally blocks, the hot thread
+   must run before the niced one. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static int64_t start_time;
+static volatile bool main_done;
+static struct semaphore done_sema;
+
+static void hot_thread (void *);
+static void niced_thread (void *);
+
+void
+test_mlfqs_decay_ready (void) 
+{
+  ASSERT (thread_mlfqs);
+
+  sema_init (&done_sema, 0);
+  thread_set_nice (-20);
+
+  /* Start at a second boundary, so that the hot thread's spin
+     does not straddle a decay. */
+  timer_sleep (TIMER_FREQ - timer_ticks () % TIMER_FREQ);
+  start_time = timer_ticks ();
+
+  thread_create ("niced", PRI_DEFAULT, niced_thread, NULL);
+  thread_create ("hot", PRI_DEFAULT, hot_thread, NULL);
+
+  timer_sleep (90 - timer_elapsed (start_time));
+  msg ("Main thread spinning across two decays...");
+  while (timer_elapsed (start_time) < 2 * TIMER_FREQ + 50)
+    continue;
+  main_done = true;
+
+  sema_down (&done_sema);
+  sema_down (&done_sema);
+}
+
+static void
+hot_thread (void *aux UNUSED) 
+{
+  thread_set_nice (0);
+  while (!main_done)
+    continue;
+  msg ("Hot thread running.");
+  sema_up (&done_sema);
+}
+
+static void
+niced_thread (void *aux UNUSED) 
+{
+  thread_set_nice (10);
+  timer_sleep (90 - timer_elapsed (start_time));
+  while (!main_done)
+    continue;
+  msg ("Niced thread running.");
+  sema_up (&done_sema);
+}
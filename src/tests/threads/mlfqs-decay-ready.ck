@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mlfqs-decay-ready) begin
+(mlfqs-decay-ready) Main thread spinning across two decays...
+(mlfqs-decay-ready) Hot thread running.
+(mlfqs-decay-ready) Niced thread running.
+(mlfqs-decay-ready) end
+EOF
+pass;
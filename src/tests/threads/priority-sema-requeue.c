@@ -0,0 +1,70 @@
+/* Three threads wait on a semaphore: W at priority 32, then X
+   and Y at priority 33.  X and Y have equal priority and must be
+   woken in the order they went to sleep.  W holds a lock, and
+   while it is waiting a thread at priority 40 blocks on that
+   lock, donating its priority to W.  W must then move to the
+   front of the semaphore's wait queue. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static struct semaphore sema;
+static struct lock lock;
+
+static thread_func holder_thread_func;
+static thread_func waiter_thread_func;
+static thread_func donor_thread_func;
+
+void
+test_priority_sema_requeue (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&sema, 0);
+  lock_init (&lock);
+
+  thread_create ("W", PRI_DEFAULT + 1, holder_thread_func, NULL);
+  thread_create ("X", PRI_DEFAULT + 2, waiter_thread_func, NULL);
+  thread_create ("Y", PRI_DEFAULT + 2, waiter_thread_func, NULL);
+  thread_create ("donor", PRI_DEFAULT + 9, donor_thread_func, NULL);
+
+  for (i = 0; i < 3; i++) 
+    {
+      msg ("main: up");
+      sema_up (&sema);
+    }
+  msg ("main: done");
+}
+
+static void
+holder_thread_func (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  sema_down (&sema);
+  msg ("W: woke at priority %d", thread_get_priority ());
+  lock_release (&lock);
+}
+
+static void
+waiter_thread_func (void *aux UNUSED) 
+{
+  sema_down (&sema);
+  msg ("%s: woke", thread_name ());
+}
+
+static void
+donor_thread_func (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  msg ("donor: got the lock");
+  lock_release (&lock);
+}
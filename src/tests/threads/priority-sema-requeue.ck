@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-sema-requeue) begin
+(priority-sema-requeue) main: up
+(priority-sema-requeue) W: woke at priority 40
+(priority-sema-requeue) donor: got the lock
+(priority-sema-requeue) main: up
+(priority-sema-requeue) X: woke
+(priority-sema-requeue) main: up
+(priority-sema-requeue) Y: woke
+(priority-sema-requeue) main: done
+(priority-sema-requeue) end
+EOF
+pass;
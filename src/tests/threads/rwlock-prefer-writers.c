@@ -0,0 +1,72 @@
+/* With a writer-preferring reader-writer lock, a reader that
+   arrives while a writer waits for an active reader to leave
+   must queue behind the writer instead of joining that reader.
+   While it waits it donates its higher priority to the writer.
+
+   Reader A holds the lock for reading.  The writer then waits
+   for it, and reader B, at a higher priority, arrives behind
+   the writer.  When A leaves, the writer must write at B's
+   priority, and only then may B read. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static struct rwlock rwlock;
+static struct semaphore go;
+
+static thread_func reader_a_thread_func;
+static thread_func reader_b_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_prefer_writers (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock, true);
+  sema_init (&go, 0);
+
+  thread_create ("reader A", PRI_DEFAULT + 1, reader_a_thread_func, NULL);
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, NULL);
+  thread_create ("reader B", PRI_DEFAULT + 2, reader_b_thread_func, NULL);
+
+  msg ("main: releasing reader A");
+  sema_up (&go);
+  msg ("Readers and writer must already have finished.");
+}
+
+static void
+reader_a_thread_func (void *aux UNUSED) 
+{
+  rwlock_read_acquire (&rwlock);
+  msg ("reader A: reading");
+  sema_down (&go);
+  msg ("reader A: releasing");
+  rwlock_read_release (&rwlock);
+}
+
+static void
+reader_b_thread_func (void *aux UNUSED) 
+{
+  msg ("reader B: acquiring");
+  rwlock_read_acquire (&rwlock);
+  msg ("reader B: reading");
+  rwlock_read_release (&rwlock);
+}
+
+static void
+writer_thread_func (void *aux UNUSED) 
+{
+  msg ("writer: acquiring");
+  rwlock_write_acquire (&rwlock);
+  msg ("writer: writing at priority %d", thread_get_priority ());
+  rwlock_write_release (&rwlock);
+  msg ("writer: done");
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-prefer-writers) begin
+(rwlock-prefer-writers) reader A: reading
+(rwlock-prefer-writers) writer: acquiring
+(rwlock-prefer-writers) reader B: acquiring
+(rwlock-prefer-writers) main: releasing reader A
+(rwlock-prefer-writers) reader A: releasing
+(rwlock-prefer-writers) writer: writing at priority 33
+(rwlock-prefer-writers) reader B: reading
+(rwlock-prefer-writers) writer: done
+(rwlock-prefer-writers) Readers and writer must already have finished.
+(rwlock-prefer-writers) end
+EOF
+pass;
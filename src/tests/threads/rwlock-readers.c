@@ -0,0 +1,71 @@
+/* Creates several readers that take a reader-writer lock at the
+   same time and then block while holding it.  A writer must wait
+   for all of them to leave.  Since the lock does not prefer
+   writers, a reader that arrives while the writer is waiting
+   still joins the active readers. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define READER_CNT 4
+
+static struct rwlock rwlock;
+static struct semaphore go;
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_readers (void) 
+{
+  int ids[READER_CNT];
+  char name[16];
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock, false);
+  sema_init (&go, 0);
+
+  for (i = 0; i < READER_CNT; i++) 
+    {
+      ids[i] = i;
+      if (i == READER_CNT - 1)
+        thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, NULL);
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT + 1, reader_thread_func, &ids[i]);
+    }
+
+  msg ("main: releasing readers");
+  for (i = 0; i < READER_CNT; i++)
+    sema_up (&go);
+  msg ("Readers and writer must already have finished.");
+}
+
+static void
+reader_thread_func (void *id_) 
+{
+  int *id = id_;
+
+  rwlock_read_acquire (&rwlock);
+  msg ("reader %d: reading", *id);
+  sema_down (&go);
+  msg ("reader %d: releasing", *id);
+  rwlock_read_release (&rwlock);
+}
+
+static void
+writer_thread_func (void *aux UNUSED) 
+{
+  msg ("writer: acquiring");
+  rwlock_write_acquire (&rwlock);
+  msg ("writer: writing");
+  rwlock_write_release (&rwlock);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-readers) begin
+(rwlock-readers) reader 0: reading
+(rwlock-readers) reader 1: reading
+(rwlock-readers) reader 2: reading
+(rwlock-readers) writer: acquiring
+(rwlock-readers) reader 3: reading
+(rwlock-readers) main: releasing readers
+(rwlock-readers) reader 0: releasing
+(rwlock-readers) reader 1: releasing
+(rwlock-readers) reader 2: releasing
+(rwlock-readers) reader 3: releasing
+(rwlock-readers) writer: writing
+(rwlock-readers) Readers and writer must already have finished.
+(rwlock-readers) end
+EOF
+pass;
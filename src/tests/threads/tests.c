@@ -17,6 +17,7 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"timer-wheel", test_timer_wheel},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -28,7 +29,13 @@ static const struct test tests[] =
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
+    {"priority-sema-requeue", test_priority_sema_requeue},
     {"priority-condvar", test_priority_condvar},
+    {"rwlock-readers", test_rwlock_readers},
+    {"rwlock-prefer-writers", test_rwlock_prefer_writers},
+    {"workqueue-priority", test_workqueue_priority},
+    {"edf-admission", test_edf_admission},
+    {"cpugroup-throttle", test_cpugroup_throttle},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -38,6 +45,10 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-decay-ready", test_mlfqs_decay_ready},
+    {"cfs-fair-3", test_cfs_fair_3},
+    {"cfs-nice-3", test_cfs_nice_3},
+    {"cfs-sleeper", test_cfs_sleeper},
   };
 
 static const char *test_name;
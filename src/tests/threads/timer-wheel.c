@@ -0,0 +1,68 @@
+/* Schedules timer events at deadlines in scrambled order, some
+   within the timer wheel's first level and some far enough out
+   that they must cascade down from the coarser levels, and
+   cancels one of them.  The others must fire in deadline order,
+   none before its deadline. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "devices/timer.h"
+
+/* Deadlines, in ticks from the start of the test. */
+static const int offsets[] = {70, 5, 300, 1, 64, 130, 65, 3, 100};
+#define EVENT_CNT (sizeof offsets / sizeof *offsets)
+
+/* Index of the event that is cancelled. */
+#define CANCELLED 8
+
+static struct timer_event events[EVENT_CNT];
+static int64_t fired_at[EVENT_CNT];
+static int order[EVENT_CNT];
+static int fired_cnt;
+static struct semaphore done;
+
+static timer_callback_func record_expiry;
+
+void
+test_timer_wheel (void) 
+{
+  int64_t start;
+  size_t i;
+
+  sema_init (&done, 0);
+  start = timer_ticks ();
+  for (i = 0; i < EVENT_CNT; i++)
+    timer_add (&events[i], start + offsets[i], record_expiry, (void *) i);
+
+  msg ("cancel pending event: %s",
+       timer_cancel (&events[CANCELLED]) ? "true" : "false");
+  msg ("cancel cancelled event: %s",
+       timer_cancel (&events[CANCELLED]) ? "true" : "false");
+
+  sema_down (&done);
+  for (i = 0; i < EVENT_CNT - 1; i++) 
+    {
+      int e = order[i];
+      if (fired_at[e] < events[e].deadline)
+        fail ("event at +%d fired %lld ticks early", offsets[e],
+              events[e].deadline - fired_at[e]);
+      msg ("event at +%d fired", offsets[e]);
+    }
+  msg ("cancel fired event: %s",
+       timer_cancel (&events[0]) ? "true" : "false");
+}
+
+/* Records that the event with index AUX has fired.  Runs in the
+   timer softirq. */
+static void
+record_expiry (void *aux) 
+{
+  int e = (int) aux;
+
+  fired_at[e] = timer_ticks ();
+  order[fired_cnt++] = e;
+  if (fired_cnt == EVENT_CNT - 1)
+    sema_up (&done);
+}
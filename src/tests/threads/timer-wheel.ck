@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(timer-wheel) begin
+(timer-wheel) cancel pending event: true
+(timer-wheel) cancel cancelled event: false
+(timer-wheel) event at +1 fired
+(timer-wheel) event at +3 fired
+(timer-wheel) event at +5 fired
+(timer-wheel) event at +64 fired
+(timer-wheel) event at +65 fired
+(timer-wheel) event at +70 fired
+(timer-wheel) event at +130 fired
+(timer-wheel) event at +300 fired
+(timer-wheel) cancel fired event: false
+(timer-wheel) end
+EOF
+pass;
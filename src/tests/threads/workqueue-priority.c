@@ -0,0 +1,73 @@
+/* Queues work items of different priorities on a workqueue whose
+   only worker has a lower priority than the main thread, so that
+   nothing runs until the main thread blocks.  The items must
+   then run highest priority first, in FIFO order among equal
+   priorities, each at its own priority.  Also checks that a
+   pending item cannot be queued twice and that only a pending
+   item can be cancelled. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+static struct workqueue wq;
+static struct work high1, high2, mid1, mid2, low, cancelled;
+static struct semaphore done;
+
+static work_func run_item;
+static work_func run_last;
+
+void
+test_workqueue_priority (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  sema_init (&done, 0);
+  if (!workqueue_init (&wq, "wq", 1, PRI_DEFAULT - 1))
+    fail ("could not start a worker");
+
+  work_init (&mid1, run_item, "mid 1");
+  work_init (&high1, run_item, "high 1");
+  work_init (&low, run_last, "low");
+  work_init (&cancelled, run_item, "cancelled");
+  work_init (&mid2, run_item, "mid 2");
+  work_init (&high2, run_item, "high 2");
+
+  workqueue_queue (&wq, &mid1, PRI_DEFAULT + 5);
+  workqueue_queue (&wq, &high1, PRI_DEFAULT + 10);
+  workqueue_queue (&wq, &low, PRI_MIN);
+  workqueue_queue (&wq, &cancelled, PRI_DEFAULT + 10);
+  workqueue_queue (&wq, &mid2, PRI_DEFAULT + 5);
+  workqueue_queue (&wq, &high2, PRI_DEFAULT + 10);
+
+  msg ("queue pending item again: %s",
+       workqueue_queue (&wq, &mid1, PRI_MAX) ? "true" : "false");
+  msg ("cancel pending item: %s",
+       workqueue_cancel (&wq, &cancelled) ? "true" : "false");
+  msg ("cancel cancelled item: %s",
+       workqueue_cancel (&wq, &cancelled) ? "true" : "false");
+
+  sema_down (&done);
+  msg ("cancel finished item: %s",
+       workqueue_cancel (&wq, &high1) ? "true" : "false");
+}
+
+static void
+run_item (void *name) 
+{
+  msg ("run %s at priority %d", (const char *) name, thread_get_priority ());
+}
+
+static void
+run_last (void *name) 
+{
+  run_item (name);
+  sema_up (&done);
+}
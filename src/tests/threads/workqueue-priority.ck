@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue-priority) begin
+(workqueue-priority) queue pending item again: false
+(workqueue-priority) cancel pending item: true
+(workqueue-priority) cancel cancelled item: false
+(workqueue-priority) run high 1 at priority 41
+(workqueue-priority) run high 2 at priority 41
+(workqueue-priority) run mid 1 at priority 36
+(workqueue-priority) run mid 2 at priority 36
+(workqueue-priority) run low at priority 0
+(workqueue-priority) cancel finished item: false
+(workqueue-priority) end
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Checks the counts returned by futex_wake().  Three threads
+   sleep on one futex; waking at most two must wake exactly two,
+   waking more must then wake the last one, and after that there
+   is nobody left to wake.  Also checks that futex_wait() returns
+   at once if the futex no longer holds the expected value. */
+
+#include <syscall.h>
+#include <uthread.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define WAITER_CNT 3
+
+static char stacks[WAITER_CNT][4096];
+static int word;
+static volatile int arrived;
+
+static int
+waiter (void *aux UNUSED) 
+{
+  asm volatile ("lock incl %0" : "+m" (arrived));
+  while (*(volatile int *) &word == 0)
+    futex_wait (&word, 0);
+  return 0;
+}
+
+void
+test_main (void) 
+{
+  pid_t tids[WAITER_CNT];
+  int i;
+
+  CHECK (futex_wait (&word, 1) == -1,
+         "futex_wait on a changed value returns at once");
+  CHECK (futex_wake (&word, 1) == 0, "futex_wake with no waiters wakes none");
+
+  for (i = 0; i < WAITER_CNT; i++)
+    CHECK ((tids[i] = uthread_create (waiter, NULL, stacks[i],
+                                      sizeof stacks[i])) != PID_ERROR,
+           "create waiter %d", i);
+  while (arrived < WAITER_CNT)
+    continue;
+
+  word = 1;
+  CHECK (futex_wake (&word, 2) == 2, "wake 2 of 3 waiters");
+  CHECK (futex_wake (&word, 10) == 1, "wake the last waiter");
+  CHECK (futex_wake (&word, 10) == 0, "no waiters left");
+
+  for (i = 0; i < WAITER_CNT; i++)
+    CHECK (uthread_join (tids[i]) == 0, "join waiter %d", i);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(futex-wake) begin
+(futex-wake) futex_wait on a changed value returns at once
+(futex-wake) futex_wake with no waiters wakes none
+(futex-wake) create waiter 0
+(futex-wake) create waiter 1
+(futex-wake) create waiter 2
+(futex-wake) wake 2 of 3 waiters
+(futex-wake) wake the last waiter
+(futex-wake) no waiters left
+(futex-wake) join waiter 0
+(futex-wake) join waiter 1
+(futex-wake) join waiter 2
+(futex-wake) end
+futex-wake: exit(0)
+EOF
+pass;
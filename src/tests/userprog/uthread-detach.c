@@ -0,0 +1,67 @@
+/* Spawns three times as many threads as a process has thread
+   slots, detaching each one and joining none.  A detached
+   thread's slot must be freed when it exits, or spawning runs
+   out of slots.  A detached thread can be neither joined nor
+   detached again. */
+
+#include <syscall.h>
+#include <uthread.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+/* Thread slots per process, MAX_USER_THREADS in the kernel. */
+#define SLOTS 16
+#define ROUNDS 3
+
+/* Round R uses stacks[R % 2].  All of round R - 1's threads have
+   exited, and freed their stacks, by the time round R + 1 has
+   filled every slot. */
+static char stacks[2][SLOTS][1024];
+static char spare_stack[1024];
+static int gate;
+
+static int
+waiter (void *round_) 
+{
+  int round = (int) round_;
+
+  while (*(volatile int *) &gate <= round)
+    futex_wait (&gate, round);
+  return 0;
+}
+
+void
+test_main (void) 
+{
+  pid_t tid = PID_ERROR;
+  int round, i;
+
+  for (round = 0; round < ROUNDS; round++) 
+    {
+      for (i = 0; i < SLOTS; i++) 
+        {
+          /* The last round's threads free their slots as they get
+             to run and exit. */
+          do
+            tid = uthread_create (waiter, (void *) round,
+                                  stacks[round % 2][i],
+                                  sizeof stacks[round % 2][i]);
+          while (tid == PID_ERROR);
+          if (uthread_detach (tid) != 0)
+            fail ("detach thread %d of round %d", i, round);
+        }
+      msg ("round %d: spawned and detached %d threads", round, SLOTS);
+
+      if (round == 0) 
+        {
+          CHECK (uthread_create (waiter, (void *) round, spare_stack,
+                                 sizeof spare_stack) == PID_ERROR,
+                 "no slot left while they run");
+          CHECK (uthread_join (tid) == -1, "join detached thread fails");
+          CHECK (uthread_detach (tid) == -1, "second detach fails");
+        }
+
+      gate = round + 1;
+      futex_wake (&gate, SLOTS);
+    }
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uthread-detach) begin
+(uthread-detach) round 0: spawned and detached 16 threads
+(uthread-detach) no slot left while they run
+(uthread-detach) join detached thread fails
+(uthread-detach) second detach fails
+(uthread-detach) round 1: spawned and detached 16 threads
+(uthread-detach) round 2: spawned and detached 16 threads
+(uthread-detach) end
+uthread-detach: exit(0)
+EOF
+pass;
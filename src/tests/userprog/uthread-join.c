@@ -0,0 +1,75 @@
+/* Checks uthread_join().  It must return the value a thread
+   returned or passed to exit(), and fail for a second join of
+   the same thread, for a thread joining itself and for an
+   unknown tid.  wait() must refuse a user thread, which is not
+   a child process. */
+
+#include <syscall.h>
+#include <uthread.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char stacks[4][4096];
+static volatile pid_t self_tid = PID_ERROR;
+static int gate;
+
+static int
+return_42 (void *aux UNUSED) 
+{
+  return 42;
+}
+
+static int
+exit_7 (void *aux UNUSED) 
+{
+  exit (7);
+}
+
+static int
+join_self (void *aux UNUSED) 
+{
+  while (self_tid == PID_ERROR)
+    continue;
+  return 100 + uthread_join (self_tid);
+}
+
+static int
+sleeper (void *aux UNUSED) 
+{
+  while (*(volatile int *) &gate == 0)
+    futex_wait (&gate, 0);
+  return 0;
+}
+
+void
+test_main (void) 
+{
+  pid_t tid;
+
+  CHECK ((tid = uthread_create (return_42, NULL, stacks[0],
+                                sizeof stacks[0])) != PID_ERROR,
+         "create thread returning 42");
+  CHECK (uthread_join (tid) == 42, "join returns 42");
+  CHECK (uthread_join (tid) == -1, "second join fails");
+
+  CHECK ((tid = uthread_create (exit_7, NULL, stacks[1],
+                                sizeof stacks[1])) != PID_ERROR,
+         "create thread calling exit(7)");
+  CHECK (uthread_join (tid) == 7, "join returns 7");
+
+  CHECK ((tid = uthread_create (join_self, NULL, stacks[2],
+                                sizeof stacks[2])) != PID_ERROR,
+         "create thread joining itself");
+  self_tid = tid;
+  CHECK (uthread_join (tid) == 99, "self-join fails");
+
+  CHECK ((tid = uthread_create (sleeper, NULL, stacks[3],
+                                sizeof stacks[3])) != PID_ERROR,
+         "create sleeping thread");
+  CHECK (wait (tid) == -1, "wait on a thread fails");
+  gate = 1;
+  futex_wake (&gate, 1);
+  CHECK (uthread_join (tid) == 0, "join woken thread");
+
+  CHECK (uthread_join (12345) == -1, "join unknown tid fails");
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uthread-join) begin
+(uthread-join) create thread returning 42
+(uthread-join) join returns 42
+(uthread-join) second join fails
+(uthread-join) create thread calling exit(7)
+(uthread-join) join returns 7
+(uthread-join) create thread joining itself
+(uthread-join) self-join fails
+(uthread-join) create sleeping thread
+(uthread-join) wait on a thread fails
+(uthread-join) join woken thread
+(uthread-join) join unknown tid fails
+(uthread-join) end
+uthread-join: exit(0)
+EOF
+pass;
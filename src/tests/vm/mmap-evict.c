@@ -0,0 +1,105 @@
+/* Dirties every page of a mapped file, then touches 2 MB of
+   other memory so that the mapped pages are evicted: written
+   back to the file, or to swap when the file system is busy.
+   Part of the pressure comes from read() system calls, which
+   fault while holding the file system lock.  The mapping must
+   still read back correctly, and once it is unmapped the file
+   must hold everything written through it. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define MAP_PAGES 64
+#define MAP_SIZE (MAP_PAGES * PAGE_SIZE)
+#define BUF_SIZE (2 * 1024 * 1024)
+
+#define ACTUAL ((char *) 0x10000000)
+
+static char buf[BUF_SIZE];
+
+/* Returns the byte expected at offset OFS of page PAGE after
+   PASS, which is 1 for every page, and 2 for the odd pages once
+   they have been rewritten. */
+static char
+pattern (int page, int ofs, int pass) 
+{
+  return (page * 31 + ofs + pass * 101) & 0xff;
+}
+
+static void
+fill_page (char *p, int page, int pass) 
+{
+  int ofs;
+
+  for (ofs = 0; ofs < PAGE_SIZE; ofs++)
+    p[ofs] = pattern (page, ofs, pass);
+}
+
+static void
+check_page (const char *p, int page, int pass, const char *where) 
+{
+  int ofs;
+
+  for (ofs = 0; ofs < PAGE_SIZE; ofs++)
+    if (p[ofs] != pattern (page, ofs, pass))
+      fail ("%s: byte %d of page %d is wrong", where, ofs, page);
+}
+
+static void
+apply_pressure (int handle) 
+{
+  size_t ofs;
+
+  memset (buf, 0x5a, BUF_SIZE);
+  for (ofs = 0; ofs + MAP_SIZE <= BUF_SIZE; ofs += MAP_SIZE) 
+    {
+      seek (handle, 0);
+      if (read (handle, buf + ofs, MAP_SIZE) != MAP_SIZE)
+        fail ("read into page-out buffer");
+    }
+}
+
+void
+test_main (void)
+{
+  static char page[PAGE_SIZE];
+  int handle, i;
+  mapid_t map;
+
+  CHECK (create ("evict.dat", MAP_SIZE), "create \"evict.dat\"");
+  CHECK ((handle = open ("evict.dat")) > 1, "open \"evict.dat\"");
+  CHECK ((map = mmap (handle, ACTUAL)) != MAP_FAILED, "mmap \"evict.dat\"");
+
+  msg ("dirty every mapped page");
+  for (i = 0; i < MAP_PAGES; i++)
+    fill_page (ACTUAL + i * PAGE_SIZE, i, 1);
+
+  msg ("page out");
+  apply_pressure (handle);
+
+  msg ("check mapping");
+  for (i = 0; i < MAP_PAGES; i++)
+    check_page (ACTUAL + i * PAGE_SIZE, i, 1, "mapping");
+
+  msg ("rewrite odd pages");
+  for (i = 1; i < MAP_PAGES; i += 2)
+    fill_page (ACTUAL + i * PAGE_SIZE, i, 2);
+
+  msg ("page out again");
+  apply_pressure (handle);
+
+  munmap (map);
+
+  msg ("check file");
+  seek (handle, 0);
+  for (i = 0; i < MAP_PAGES; i++) 
+    {
+      if (read (handle, page, PAGE_SIZE) != PAGE_SIZE)
+        fail ("read page %d of \"evict.dat\"", i);
+      check_page (page, i, i % 2 ? 2 : 1, "file");
+    }
+  close (handle);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-evict) begin
+(mmap-evict) create "evict.dat"
+(mmap-evict) open "evict.dat"
+(mmap-evict) mmap "evict.dat"
+(mmap-evict) dirty every mapped page
+(mmap-evict) page out
+(mmap-evict) check mapping
+(mmap-evict) rewrite odd pages
+(mmap-evict) page out again
+(mmap-evict) check file
+(mmap-evict) end
+EOF
+pass;
@@ -0,0 +1,184 @@
+/*! \file cpugroup.c
+ *
+ * CPU bandwidth groups.
+ *
+ * A thread created by a thread in a group joins its creator's group, so a
+ * process and all of its descendants share one quota.  thread_tick()
+ * charges each tick to the running thread's group; once the group has
+ * used its quota for the period it is throttled.  Throttled threads are
+ * not taken off the run queues eagerly: when next_thread_to_run() comes
+ * across one it parks it on the group's list instead of running it, and
+ * the timer event that starts the group's next period unblocks every
+ * parked thread again.
+ */
+
+#include "threads/cpugroup.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/*! All CPU bandwidth groups. */
+static struct list groups;
+
+/*! Identifier for the next group created. */
+static int next_id = 1;
+
+static timer_callback_func cpugroup_refill;
+
+/*! Initializes the CPU bandwidth group system. */
+void cpugroup_init(void) {
+    list_init(&groups);
+}
+
+/*! Creates a group whose threads may run for QUOTA ticks in every PERIOD
+    ticks, and moves the current thread into it.  Threads the current thread
+    creates from now on will join it too.  Returns the new group's
+    identifier, or -1 if the parameters are not 0 < QUOTA <= PERIOD or
+    memory is exhausted. */
+int cpugroup_new(int64_t quota, int64_t period) {
+    struct thread *cur = thread_current();
+    struct cpugroup *g;
+    enum intr_level old_level;
+
+    ASSERT(!intr_context());
+
+    if (quota <= 0 || quota > period)
+        return -1;
+    g = malloc(sizeof *g);
+    if (g == NULL)
+        return -1;
+
+    g->quota = quota;
+    g->period = period;
+    g->used = 0;
+    g->usage = 0;
+    g->throttled_periods = 0;
+    g->nr_threads = 0;
+    g->throttled = false;
+    list_init(&g->parked);
+
+    cpugroup_leave(cur);
+
+    old_level = intr_disable();
+    g->id = next_id++;
+    list_push_back(&groups, &g->elem);
+    cpugroup_join(cur, g);
+    timer_add(&g->timer, timer_ticks() + period, cpugroup_refill, g);
+    intr_set_level(old_level);
+
+    return g->id;
+}
+
+/*! Adds T, which is in no group, to G.  Does nothing if G is null. */
+void cpugroup_join(struct thread *t, struct cpugroup *g) {
+    enum intr_level old_level;
+
+    ASSERT(t->cpugroup == NULL);
+
+    if (g == NULL)
+        return;
+    old_level = intr_disable();
+    g->nr_threads++;
+    t->cpugroup = g;
+    intr_set_level(old_level);
+}
+
+/*! Removes T, which must not be parked, from its group, if it is in one.
+    The group is destroyed when its last thread leaves. */
+void cpugroup_leave(struct thread *t) {
+    struct cpugroup *g = t->cpugroup;
+    enum intr_level old_level;
+    bool last;
+
+    if (g == NULL)
+        return;
+    old_level = intr_disable();
+    t->cpugroup = NULL;
+    last = --g->nr_threads == 0;
+    if (last) {
+        ASSERT(list_empty(&g->parked));
+        timer_cancel(&g->timer);
+        list_remove(&g->elem);
+    }
+    intr_set_level(old_level);
+
+    if (last)
+        free(g);
+}
+
+/*! Charges a tick of CPU time to G, whose thread is running.  Returns true
+    if G is now throttled and so the thread should be preempted.  Called
+    from the timer interrupt. */
+bool cpugroup_charge(struct cpugroup *g) {
+    ASSERT(intr_context());
+
+    g->usage++;
+    if (g->throttled)
+        return true;
+    if (++g->used >= g->quota) {
+        g->throttled = true;
+        g->throttled_periods++;
+        return true;
+    }
+    return false;
+}
+
+/*! Parks ready thread T, which has just been taken off a run queue and
+    whose group is throttled, until its group's next period.  Interrupts
+    must be off. */
+void cpugroup_park(struct thread *t) {
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(t->status == THREAD_READY);
+    ASSERT(t->cpugroup != NULL && t->cpugroup->throttled);
+
+    t->status = THREAD_BLOCKED;
+    list_push_back(&t->cpugroup->parked, &t->elem);
+}
+
+/*! Starts a new period for group G_, lifting any throttling and putting its
+    parked threads back on the run queues.  Runs in the timer interrupt. */
+static void cpugroup_refill(void *g_) {
+    struct cpugroup *g = g_;
+    struct thread *t;
+
+    g->used = 0;
+    g->throttled = false;
+    while (!list_empty(&g->parked)) {
+        t = list_entry(list_pop_front(&g->parked), struct thread, elem);
+        thread_unblock(t);
+        if (thread_should_preempt(t))
+            intr_yield_on_return();
+    }
+    timer_add(&g->timer, timer_ticks() + g->period, cpugroup_refill, g);
+}
+
+/*! Copies the usage of the group with identifier ID into STAT.  Returns
+    false if there is no such group.  STAT may be a user address: it is
+    only written after interrupts are back on, since writing it may page
+    fault. */
+bool cpugroup_get_stat(int id, struct cpugroup_stat *stat) {
+    struct cpugroup_stat snapshot;
+    struct list_elem *e;
+    enum intr_level old_level;
+    bool found = false;
+
+    old_level = intr_disable();
+    for (e = list_begin(&groups); e != list_end(&groups); e = list_next(e)) {
+        struct cpugroup *g = list_entry(e, struct cpugroup, elem);
+        if (g->id == id) {
+            snapshot.quota = g->quota;
+            snapshot.period = g->period;
+            snapshot.usage = g->usage;
+            snapshot.throttled_periods = g->throttled_periods;
+            snapshot.nr_threads = g->nr_threads;
+            found = true;
+            break;
+        }
+    }
+    intr_set_level(old_level);
+
+    if (found)
+        *stat = snapshot;
+    return found;
+}
@@ -0,0 +1,44 @@
+/*! \file cpugroup.h
+ *
+ * Declarations for CPU bandwidth groups, which cap the CPU time used by a
+ * process and its descendants.
+ */
+
+#ifndef THREADS_CPUGROUP_H
+#define THREADS_CPUGROUP_H
+
+#include <cpugroup.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "devices/timer.h"
+
+struct thread;
+
+/*! A CPU bandwidth group.  Its threads together may run for QUOTA ticks in
+    every PERIOD ticks; once they have, the group is throttled and its
+    threads are kept off the run queues until the next period starts. */
+struct cpugroup {
+    int id;                         /*!< Group identifier. */
+    int64_t quota;                  /*!< CPU time allowed per period. */
+    int64_t period;                 /*!< Length of a period. */
+    int64_t used;                   /*!< CPU time used this period. */
+    int64_t usage;                  /*!< CPU time used since creation. */
+    unsigned throttled_periods;     /*!< Periods the quota ran out in. */
+    unsigned nr_threads;            /*!< Threads in the group. */
+    bool throttled;                 /*!< Quota used up this period? */
+    struct list parked;             /*!< Ready threads held back while
+                                         throttled. */
+    struct timer_event timer;       /*!< Fires at the next period. */
+    struct list_elem elem;          /*!< Element in the list of groups. */
+};
+
+void cpugroup_init(void);
+int cpugroup_new(int64_t quota, int64_t period);
+void cpugroup_join(struct thread *, struct cpugroup *);
+void cpugroup_leave(struct thread *);
+bool cpugroup_charge(struct cpugroup *);
+void cpugroup_park(struct thread *);
+bool cpugroup_get_stat(int id, struct cpugroup_stat *);
+
+#endif /* threads/cpugroup.h */
@@ -2,11 +2,18 @@
  *
  * Type definitions and routines for fixed-point arithmetic.
  * Use the type fixedpt for indicating a fixed-point variable.
+ *
+ * The routines are defined inline here because the MLFQS bookkeeping calls
+ * them from the timer interrupt, where a function call per operation is
+ * needless overhead.
  */
 
 #ifndef FIXEDPT_H
 #define FIXEDPT_H
 
+#include <debug.h>
+#include <stdint.h>
+
 /*! P.Q Fixed point arithmetic definitions. */
 #define FIXED_POINT_P 17
 #define FIXED_POINT_Q 14
@@ -15,24 +22,60 @@
    performance hit. */
 #define FIXED_POINT_F (1 << FIXED_POINT_Q)
 
-#define MAX_FIXEDPT (((1 << 31) - 1)/(1 << FIXED_POINT_Q))
+#define MAX_FIXEDPT (INT32_MAX / FIXED_POINT_F)
 
 
 /*! A fixed point type is just an integer */
 typedef int fixedpt;
 
 
-/* Fixed point function prototypes */
-fixedpt int_to_fixedpt(int n);
-int fixedpt_to_int_zero(fixedpt x);
-int fixedpt_to_int_nearest(fixedpt x);
+/*! Converts an integer to fixed-point type. */
+static inline fixedpt int_to_fixedpt(int n) {
+    ASSERT(n <= MAX_FIXEDPT);
+
+    return ((fixedpt) (n * FIXED_POINT_F));
+}
+
+/*! Converts a fixed-point number to an integer.
+    Rounds towards 0.
+    E.g. -3.9 -> -3
+          2.1 ->  2
+          2.9 ->  2 */
+static inline int fixedpt_to_int_zero(fixedpt x) {
+    return x / FIXED_POINT_F;
+}
+
+/*! Converts a fixed-point number to an integer.
+    Rounds canonically.
+    E.g. -3.9 -> -4
+          2.1 ->  2
+          2.9 ->  3 */
+static inline int fixedpt_to_int_nearest(fixedpt x) {
+    if (x >= 0) {
+        return (x + FIXED_POINT_F / 2) / FIXED_POINT_F;
+    } else {
+        return (x - FIXED_POINT_F / 2) / FIXED_POINT_F;
+    }
+}
 
-fixedpt fixedpt_add(fixedpt x, fixedpt y);
-fixedpt fixedpt_sub(fixedpt x, fixedpt y);
-fixedpt fixedpt_mul(fixedpt x, fixedpt y);
-fixedpt fixedpt_div(fixedpt x, fixedpt y);
+/*! Adds two fixed-point numbers. */
+static inline fixedpt fixedpt_add(fixedpt x, fixedpt y) {
+    return x + y;
+}
 
+/*! Subtracts two fixed-point numbers. */
+static inline fixedpt fixedpt_sub(fixedpt x, fixedpt y) {
+    return x - y;
+}
 
+/*! Multiplies two fixed-point numbers. */
+static inline fixedpt fixedpt_mul(fixedpt x, fixedpt y) {
+    return ((int64_t) x) * y / FIXED_POINT_F;
+}
 
+/*! Divides two fixed-point numbers. */
+static inline fixedpt fixedpt_div(fixedpt x, fixedpt y) {
+    return ((int64_t) x) * FIXED_POINT_F / y;
+}
 
 #endif
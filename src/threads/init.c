@@ -17,12 +17,16 @@
 #include "devices/vga.h"
 #include "devices/rtc.h"
 #include "threads/interrupt.h"
+#include "threads/irqsoff.h"
+#include "threads/lockstat.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 
 #ifdef USERPROG
 
@@ -41,6 +45,8 @@
 #ifdef VM
 
 #include "vm/frame.h"
+#include "vm/pageout.h"
+#include "vm/replace.h"
 #include "vm/swap.h"
 
 #endif
@@ -133,6 +139,8 @@ int main(void) {
     thread_start();
     serial_init_queue();
     timer_calibrate();
+    trace_init();
+    profile_init();
 
 #ifdef FILESYS
     /* Initialize file system. */
@@ -142,9 +150,9 @@ int main(void) {
 #endif
 
 #ifdef VM
-    hash_init(&frame_table, &frame_hash_func, &frame_less, NULL);
-    list_init(&frame_queue);
+    frame_init();
     swap_init();
+    pageout_init();
 #endif
     printf("Boot complete.\n");
 
@@ -257,12 +265,31 @@ static char ** parse_options(char **argv) {
 #ifdef VM
         else if (!strcmp(name, "-swap"))
             swap_bdev_name = value;
+        else if (!strcmp(name, "-evict")) {
+            if (value == NULL || !replace_select(value))
+                PANIC("unknown eviction policy \"%s\"", value ? value : "");
+        }
 #endif
 #endif
         else if (!strcmp(name, "-rs"))
             random_init(atoi(value));
         else if (!strcmp(name, "-mlfqs"))
             thread_mlfqs = true;
+        else if (!strcmp(name, "-cfs"))
+            thread_cfs = true;
+        else if (!strcmp(name, "-tickless"))
+            timer_tickless = true;
+        else if (!strcmp(name, "-lockstat"))
+            lockstat_enabled = true;
+        else if (!strcmp(name, "-irqsoff"))
+            irqsoff_enabled = true;
+        else if (!strcmp(name, "-trace"))
+            trace_enabled = true;
+        else if (!strcmp(name, "-profile")) {
+            profile_interval = value != NULL ? atoi(value) : 1;
+            if (profile_interval < 1)
+                PANIC("-profile interval must be at least 1");
+        }
 #ifdef USERPROG
         else if (!strcmp(name, "-ul"))
             user_page_limit = atoi(value);
@@ -271,6 +298,9 @@ static char ** parse_options(char **argv) {
             PANIC("unknown option `%s' (use -h for help)", name);
     }
 
+    if (thread_mlfqs && thread_cfs)
+        PANIC("-mlfqs and -cfs are mutually exclusive");
+
     /* Initialize the random number generator based on the system
        time.  This has no effect if an "-rs" option was specified.
 
@@ -299,6 +329,22 @@ static void run_task(char **argv) {
     printf("Execution of '%s' complete.\n", task);
 }
 
+/*! Prints scheduler statistics.  Given as the last action, this dumps them
+    as of shutdown. */
+static void run_schedstat(char **argv UNUSED) {
+    thread_print_schedstat();
+}
+
+/*! Prints lock statistics, most contended lock classes first. */
+static void run_lockstat(char **argv UNUSED) {
+    lockstat_print();
+}
+
+/*! Prints the longest interrupts-off sections seen so far. */
+static void run_irqsoff(char **argv UNUSED) {
+    irqsoff_print();
+}
+
 /*! Executes all of the actions specified in ARGV[] up to the null pointer
     sentinel. */
 static void run_actions(char **argv) {
@@ -312,6 +358,9 @@ static void run_actions(char **argv) {
     /* Table of supported actions. */
     static const struct action actions[] = {
         {"run", 2, run_task},
+        {"schedstat", 1, run_schedstat},
+        {"lockstat", 1, run_lockstat},
+        {"irqsoff", 1, run_irqsoff},
 #ifdef FILESYS
         {"ls", 1, fsutil_ls},
         {"cat", 2, fsutil_cat},
@@ -358,6 +407,9 @@ static void usage(void) {
 #else
            "  run TEST           Run TEST.\n"
 #endif
+           "  schedstat          Print scheduler statistics.\n"
+           "  lockstat           Print lock contention statistics.\n"
+           "  irqsoff            Print longest interrupts-off sections.\n"
 #ifdef FILESYS
            "  ls                 List files in the root directory.\n"
            "  cat FILE           Print FILE to the console.\n"
@@ -376,10 +428,18 @@ static void usage(void) {
            "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
 #ifdef VM
            "  -swap=BDEV         Use BDEV for swap instead of default.\n"
+           "  -evict=POLICY      Evict frames by POLICY: clock (default),\n"
+           "                     fifo, wsclock or 2q.\n"
 #endif
 #endif
            "  -rs=SEED           Set random number seed to SEED.\n"
            "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+           "  -cfs               Use completely fair scheduler.\n"
+           "  -tickless          Stop the periodic timer tick while idle.\n"
+           "  -lockstat          Record lock contention statistics.\n"
+           "  -irqsoff           Trace longest interrupts-off sections.\n"
+           "  -trace             Record trace events, saved to scratch device.\n"
+           "  -profile[=N]       Sample running code every N timer ticks.\n"
 #ifdef USERPROG
            "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
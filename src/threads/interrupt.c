@@ -6,9 +6,13 @@
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/irqsoff.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
+#ifdef USERPROG
+#include "userprog/process.h"
+#endif
 
 /*! Programmable Interrupt Controller (PIC) registers.
     A PC has two PICs, called the master and slave PICs, with the
@@ -48,6 +52,37 @@ static unsigned int unexpected_cnt[INTR_CNT];
 static bool in_external_intr;   /*! Are we processing an external interrupt? */
 static bool yield_on_return;    /*! Should we yield on interrupt return? */
 
+/*! Time spent in an interrupt handler or a softirq. */
+struct intr_time {
+    unsigned long long cnt;     /*!< Number of runs. */
+    int64_t total;              /*!< Total time, in ns. */
+    int64_t max;                /*!< Longest run, in ns. */
+};
+
+/*! Time spent in each external interrupt's handler, indexed by vector
+    number minus 0x20. */
+static struct intr_time hard_time[16];
+
+/*! Softirqs are work deferred by external interrupt handlers, so that they
+    can return quickly.  The outermost external interrupt runs them after
+    acknowledging the PIC and before returning to the interrupted thread,
+    with interrupts on.  Like external interrupt handlers, a softirq may
+    not sleep, but it may call intr_yield_on_return().  Further interrupts
+    taken while softirqs run neither run softirqs nor yield themselves;
+    the outermost one does both on their behalf. */
+struct softirq_action {
+    softirq_func *func;         /*!< Handler, null if none registered. */
+    const char *name;           /*!< Name, for debugging purposes. */
+    struct intr_time time;      /*!< Time spent running FUNC. */
+};
+static struct softirq_action softirqs[SOFTIRQ_CNT];
+static unsigned softirq_pending;        /*!< Bit N set: softirq N raised. */
+static bool in_softirq;                 /*!< Are softirqs running? */
+
+/*! Number of times softirqs raised while softirqs were running are run
+    again before leaving them for the next interrupt. */
+#define SOFTIRQ_RESTARTS 4
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init(void);
 static void pic_end_of_interrupt(int irq);
@@ -60,6 +95,8 @@ static inline uint64_t make_idtr_operand (uint16_t limit, void *base);
 /* Interrupt handlers. */
 void intr_handler(struct intr_frame *args);
 static void unexpected_interrupt(const struct intr_frame *);
+static void softirq_run(void);
+static void intr_time_add(struct intr_time *, int64_t);
 
 /*! Returns the current interrupt status. */
 enum intr_level intr_get_level(void) {
@@ -74,16 +111,13 @@ enum intr_level intr_get_level(void) {
     return flags & FLAG_IF ? INTR_ON : INTR_OFF;
 }
 
-/*! Enables or disables interrupts as specified by LEVEL and
-    returns the previous interrupt status. */
-enum intr_level intr_set_level(enum intr_level level) {
-    return level == INTR_ON ? intr_enable() : intr_disable();
-}
-
-/*! Enables interrupts and returns the previous interrupt status. */
-enum intr_level intr_enable(void) {
+/*! Enables interrupts on behalf of the caller at SITE and returns the
+    previous interrupt status. */
+static enum intr_level enable(const void *site) {
     enum intr_level old_level = intr_get_level();
-    ASSERT (!intr_context());
+
+    if (old_level == INTR_OFF)
+        irqsoff_end(site);
 
     /* Enable interrupts by setting the interrupt flag.
 
@@ -94,8 +128,9 @@ enum intr_level intr_enable(void) {
     return old_level;
 }
 
-/*! Disables interrupts and returns the previous interrupt status. */
-enum intr_level intr_disable(void) {
+/*! Disables interrupts on behalf of the caller at SITE and returns the
+    previous interrupt status. */
+static enum intr_level disable(const void *site) {
     enum intr_level old_level = intr_get_level();
 
     /* Disable interrupts by clearing the interrupt flag.
@@ -103,9 +138,32 @@ enum intr_level intr_disable(void) {
        Hardware Interrupts". */
     asm volatile ("cli" : : : "memory");
 
+    if (old_level == INTR_ON)
+        irqsoff_begin(site);
+
     return old_level;
 }
-
+
+/*! Enables or disables interrupts as specified by LEVEL and
+    returns the previous interrupt status. */
+enum intr_level intr_set_level(enum intr_level level) {
+    const void *site = __builtin_return_address(0);
+    ASSERT(level == INTR_OFF || !in_external_intr);
+    return level == INTR_ON ? enable(site) : disable(site);
+}
+
+/*! Enables interrupts and returns the previous interrupt status.  May not
+    be called by an external interrupt handler, although a softirq may. */
+enum intr_level intr_enable(void) {
+    ASSERT(!in_external_intr);
+    return enable(__builtin_return_address(0));
+}
+
+/*! Disables interrupts and returns the previous interrupt status. */
+enum intr_level intr_disable(void) {
+    return disable(__builtin_return_address(0));
+}
+
 /*! Initializes the interrupt system. */
 void intr_init(void) {
     uint64_t idtr_operand;
@@ -195,17 +253,101 @@ void intr_register_int(uint8_t vec_no, int dpl, enum intr_level level,
 /*! Returns true during processing of an external interrupt
     and false at all other times. */
 bool intr_context(void) {
-    return in_external_intr;
+    return in_external_intr || in_softirq;
 }
 
-/*! During processing of an external interrupt, directs the interrupt handler
-    to yield to a new process just before returning from the interrupt.  May
-    not be called at any other time. */
+/*! During processing of an external interrupt or a softirq, directs the
+    interrupt handler to yield to a new process just before returning from
+    the interrupt.  May not be called at any other time. */
 void intr_yield_on_return(void) {
     ASSERT(intr_context());
     yield_on_return = true;
 }
 
+/* Softirqs. */
+
+/*! Registers FUNC, named NAME for debugging purposes, to run as softirq
+    NR. */
+void softirq_register(enum softirq nr, softirq_func *func, const char *name) {
+    ASSERT(nr < SOFTIRQ_CNT);
+    ASSERT(softirqs[nr].func == NULL);
+
+    softirqs[nr].func = func;
+    softirqs[nr].name = name;
+}
+
+/*! Arranges for softirq NR to run before the current external interrupt
+    returns or, if called outside one, when the next one returns.
+    Interrupts must be off. */
+void softirq_raise(enum softirq nr) {
+    ASSERT(nr < SOFTIRQ_CNT);
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    softirq_pending |= 1u << nr;
+}
+
+/*! Runs pending softirqs with interrupts on.  Called by the outermost
+    external interrupt, with interrupts off, just before it returns. */
+static void softirq_run(void) {
+    int restarts;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(!in_softirq);
+
+    in_softirq = true;
+    for (restarts = 0; softirq_pending != 0 && restarts < SOFTIRQ_RESTARTS;
+         restarts++) {
+        unsigned pending = softirq_pending;
+        int nr;
+
+        softirq_pending = 0;
+        for (nr = 0; nr < SOFTIRQ_CNT; nr++) {
+            struct softirq_action *a = &softirqs[nr];
+            int64_t start;
+
+            if ((pending & (1u << nr)) == 0 || a->func == NULL)
+                continue;
+
+            start = timer_now_ns();
+            enable(a->func);
+            a->func();
+            disable(a->func);
+            intr_time_add(&a->time, timer_now_ns() - start);
+        }
+    }
+    in_softirq = false;
+}
+
+/*! Accounts a run of NS nanoseconds to T. */
+static void intr_time_add(struct intr_time *t, int64_t ns) {
+    t->cnt++;
+    t->total += ns;
+    if (ns > t->max)
+        t->max = ns;
+}
+
+/*! Prints the time spent in each external interrupt's handler, and in
+    the softirqs that handlers deferred work to. */
+void intr_print_stats(void) {
+    int i;
+
+    printf("%-20s%10s %10s %10s\n", "Interrupts:", "count", "avg us", "max us");
+    for (i = 0; i < 16; i++) {
+        struct intr_time *t = &hard_time[i];
+        if (t->cnt != 0)
+            printf("  %#04x %-12s %10llu %10"PRId64" %10"PRId64"\n",
+                   i + 0x20, intr_names[i + 0x20], t->cnt,
+                   t->total / (int64_t) t->cnt / 1000, t->max / 1000);
+    }
+    for (i = 0; i < SOFTIRQ_CNT; i++) {
+        struct intr_time *t = &softirqs[i].time;
+        if (t->cnt != 0)
+            printf("  soft %-12s %10llu %10"PRId64" %10"PRId64"\n",
+                   softirqs[i].name, t->cnt,
+                   t->total / (int64_t) t->cnt / 1000, t->max / 1000);
+    }
+}
+
 /* 8259A Programmable Interrupt Controller. */
 
 /*! Initializes the PICs.  Refer to [8259A] for details.
@@ -309,7 +451,18 @@ static inline uint64_t make_idtr_operand(uint16_t limit, void *base) {
     interrupted thread's registers. */
 void intr_handler(struct intr_frame *frame) {
     bool external;
+    bool traced;
     intr_handler_func *handler;
+    int64_t start = 0;
+
+    /* Taking an interrupt through an interrupt gate turned interrupts off
+       behind the interrupted code's back; so will returning to it with
+       interrupts off, if the handler leaves them that way.  Account the
+       time in between to the handler. */
+    handler = intr_handlers[frame->vec_no];
+    traced = (frame->eflags & FLAG_IF) != 0;
+    if (traced && intr_get_level() == INTR_OFF)
+        irqsoff_begin(handler);
 
     /* External interrupts are special.
        We only handle one at a time (so interrupts must be off)
@@ -318,14 +471,20 @@ void intr_handler(struct intr_frame *frame) {
     external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
     if (external) {
         ASSERT(intr_get_level() == INTR_OFF);
-        ASSERT(!intr_context());
+        ASSERT(!in_external_intr);
 
+        start = timer_now_ns();
         in_external_intr = true;
-        yield_on_return = false;
+        if (!in_softirq)
+            yield_on_return = false;
+
+        /* If the idle thread stopped the periodic timer tick, restart it
+           before anything looks at the time. */
+        if (frame->vec_no != 0x20)
+            timer_exit_idle();
     }
 
     /* Invoke the interrupt's handler. */
-    handler = intr_handlers[frame->vec_no];
     if (handler != NULL) {
         handler(frame);
     }
@@ -345,10 +504,27 @@ void intr_handler(struct intr_frame *frame) {
 
         in_external_intr = false;
         pic_end_of_interrupt(frame->vec_no); 
-
-        if (yield_on_return) 
-            thread_yield(); 
+        intr_time_add(&hard_time[frame->vec_no - 0x20],
+                      timer_now_ns() - start);
+
+        /* Only the outermost interrupt runs softirqs or yields. */
+        if (!in_softirq) {
+            softirq_run();
+            if (yield_on_return) 
+                thread_yield(); 
+        }
     }
+
+#ifdef USERPROG
+    /* A thread about to return to user code exits instead if its process
+       is going away, even if it never makes another system call. */
+    if ((frame->cs & 3) == 3)
+        process_check_exit();
+#endif
+
+    /* The return from interrupt turns interrupts back on. */
+    if (traced && intr_get_level() == INTR_OFF)
+        irqsoff_end(handler);
 }
 
 /*! Handles an unexpected interrupt with interrupt frame F.  An
@@ -74,6 +74,21 @@ void intr_yield_on_return(void);
 
 void intr_dump_frame(const struct intr_frame *);
 const char *intr_name(uint8_t vec);
+void intr_print_stats(void);
+
+/*! Deferred interrupt work ("softirqs"), in the order in which they run. */
+enum softirq {
+    SOFTIRQ_TIMER,              /*!< Run timer events that are due. */
+    SOFTIRQ_SCHED,              /*!< Once-a-second MLFQS recomputation. */
+    SOFTIRQ_BLOCK,              /*!< Wake threads waiting for disk I/O. */
+    SOFTIRQ_SERIAL,             /*!< Pass serial input to the input layer. */
+    SOFTIRQ_CNT                 /*!< Number of softirqs. */
+};
+
+typedef void softirq_func(void);
+
+void softirq_register(enum softirq, softirq_func *, const char *name);
+void softirq_raise(enum softirq);
 
 #endif /* threads/interrupt.h */
 
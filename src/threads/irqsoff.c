@@ -0,0 +1,140 @@
+/*! \file irqsoff.c
+ *
+ * Interrupts-off latency tracer.
+ *
+ * intr_disable(), intr_enable() and intr_set_level() report every
+ * transition of the interrupt flag here, along with the address they
+ * were called from; intr_handler() does the same for the implicit
+ * transitions made by taking an interrupt and returning from it.  A
+ * section runs from the call that turned interrupts off to the one that
+ * turned them back on, and the longest sections are kept, one per site
+ * that turned interrupts off, so that a single slow path cannot crowd
+ * out the rest.  Nothing is recorded unless the "-irqsoff" option is
+ * given.
+ *
+ * Both hooks run with interrupts off, which is all the locking the
+ * tracer needs.  Sites are code addresses; pass them to the backtrace
+ * utility to turn them into function names.
+ */
+
+#include "threads/irqsoff.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "devices/timer.h"
+
+/*! Number of sections kept, and printed at shutdown. */
+#define IRQSOFF_WORST 16
+
+/*! The longest interrupts-off section seen from one disabling site. */
+struct irqsoff_section {
+    const void *off_site;       /*!< Where interrupts were turned off. */
+    const void *on_site;        /*!< Where they were turned back on. */
+    int64_t duration;           /*!< Length of the section, in ns. */
+    unsigned count;             /*!< Sections that began at OFF_SITE. */
+};
+
+static struct irqsoff_section worst[IRQSOFF_WORST];
+static int worst_cnt;
+
+/* The section in progress, if any. */
+static bool open;               /*!< Is a section in progress? */
+static const void *open_site;   /*!< Where it began. */
+static int64_t open_time;       /*!< When it began, in ns. */
+
+/* Totals over all sections. */
+static unsigned long long section_cnt;
+static int64_t total_ns;
+
+/*! Trace interrupts-off sections? */
+bool irqsoff_enabled;
+
+/*! Notes that interrupts were just turned off at SITE. */
+void irqsoff_begin(const void *site) {
+    if (!irqsoff_enabled)
+        return;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    open = true;
+    open_site = site;
+    open_time = timer_now_ns();
+}
+
+/*! Notes that interrupts are about to be turned back on at SITE, closing
+    the section in progress.  Does nothing if no section was begun, as
+    happens for the first sections after boot and after the tracer is
+    turned on. */
+void irqsoff_end(const void *site) {
+    struct irqsoff_section *s;
+    int64_t duration;
+    int i;
+
+    if (!irqsoff_enabled || !open)
+        return;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    open = false;
+    duration = timer_now_ns() - open_time;
+    section_cnt++;
+    total_ns += duration;
+
+    /* Find OPEN_SITE's entry, or failing that the shortest entry, which
+       is evicted if this section is longer. */
+    s = NULL;
+    for (i = 0; i < worst_cnt; i++) {
+        if (worst[i].off_site == open_site) {
+            s = &worst[i];
+            break;
+        }
+        if (s == NULL || worst[i].duration < s->duration)
+            s = &worst[i];
+    }
+    if (i == worst_cnt) {
+        if (worst_cnt < IRQSOFF_WORST)
+            s = &worst[worst_cnt++];
+        else if (duration <= s->duration)
+            return;
+        s->off_site = open_site;
+        s->on_site = site;
+        s->duration = duration;
+        s->count = 1;
+        return;
+    }
+
+    s->count++;
+    if (duration > s->duration) {
+        s->on_site = site;
+        s->duration = duration;
+    }
+}
+
+/*! Prints the longest interrupts-off sections, longest first. */
+void irqsoff_print(void) {
+    struct irqsoff_section sorted[IRQSOFF_WORST];
+    enum intr_level old_level;
+    int cnt, i, j;
+
+    if (!irqsoff_enabled)
+        return;
+
+    old_level = intr_disable();
+    cnt = worst_cnt;
+    for (i = 0; i < cnt; i++) {
+        struct irqsoff_section s = worst[i];
+        for (j = i; j > 0 && sorted[j - 1].duration < s.duration; j--)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = s;
+    }
+    printf("Interrupts off: %llu sections, %"PRId64" us total.\n",
+           section_cnt, total_ns / 1000);
+    intr_set_level(old_level);
+
+    printf("%10s %10s %10s %10s\n", "max us", "count", "off at", "on at");
+    for (i = 0; i < cnt; i++)
+        printf("%10"PRId64" %10u %10p %10p\n", sorted[i].duration / 1000,
+               sorted[i].count, sorted[i].off_site, sorted[i].on_site);
+}
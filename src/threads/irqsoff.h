@@ -0,0 +1,19 @@
+/*! \file irqsoff.h
+ *
+ * Declarations for the interrupts-off latency tracer.
+ */
+
+#ifndef THREADS_IRQSOFF_H
+#define THREADS_IRQSOFF_H
+
+#include <stdbool.h>
+
+/*! Trace interrupts-off sections?
+    Controlled by kernel command-line option "-irqsoff". */
+extern bool irqsoff_enabled;
+
+void irqsoff_begin(const void *site);
+void irqsoff_end(const void *site);
+void irqsoff_print(void);
+
+#endif /* threads/irqsoff.h */
@@ -0,0 +1,149 @@
+/*! \file lockstat.c
+ *
+ * Lock contention profiler.
+ *
+ * Every lock and semaphore belongs to a class named at lock_init() or
+ * sema_init() time, by default after the expression that was initialized
+ * (so all of the malloc descriptor locks, for example, share the class
+ * "d->lock").  Classes live in a fixed table so that they can be created
+ * before malloc() is available; once it is full, further classes are
+ * lumped together under "(other)".  Statistics are only gathered when the
+ * "-lockstat" option is given.
+ */
+
+#include "threads/lockstat.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+
+/*! A lock class. */
+struct lockstat_class {
+    const char *key;            /*!< Name as passed in, for fast lookup. */
+    struct lockstat stat;       /*!< Statistics, including a copy of the
+                                     name. */
+};
+
+static struct lockstat_class classes[LOCKSTAT_CLASSES];
+static int class_cnt;
+
+/*! Record lock statistics? */
+bool lockstat_enabled;
+
+/*! Returns the statistics for the lock class NAME, creating the class if
+    it does not exist yet.  A leading `&', as left by the lock_init() and
+    sema_init() macros, is dropped from the name.  Returns a null pointer
+    if statistics are not being recorded. */
+struct lockstat *lockstat_register(const char *name) {
+    struct lockstat_class *c;
+    enum intr_level old_level;
+    const char *key = name;
+    int i;
+
+    ASSERT(name != NULL);
+
+    if (!lockstat_enabled)
+        return NULL;
+
+    old_level = intr_disable();
+
+    /* Most classes are registered from a single call site, whose name
+       string is always the same pointer. */
+    for (i = 0; i < class_cnt; i++)
+        if (classes[i].key == key)
+            goto done;
+
+    if (*name == '&')
+        name++;
+    for (i = 0; i < class_cnt; i++)
+        if (!strcmp(classes[i].stat.name, name))
+            goto done;
+
+    if (class_cnt == LOCKSTAT_CLASSES - 1)
+        name = key = "(other)";
+    if (class_cnt < LOCKSTAT_CLASSES) {
+        c = &classes[class_cnt];
+        c->key = key;
+        strlcpy(c->stat.name, name, sizeof c->stat.name);
+        i = class_cnt++;
+    } else
+        i = LOCKSTAT_CLASSES - 1;
+
+done:
+    intr_set_level(old_level);
+    return &classes[i].stat;
+}
+
+/*! Records an acquisition of a lock or semaphore of class STAT, which had
+    to wait WAITED nanoseconds if CONTENDED. */
+void lockstat_record(struct lockstat *stat, bool contended, int64_t waited) {
+    enum intr_level old_level = intr_disable();
+
+    stat->acquisitions++;
+    if (contended) {
+        stat->contended++;
+        stat->wait_total += waited;
+        if (waited > stat->wait_max)
+            stat->wait_max = waited;
+    }
+    intr_set_level(old_level);
+}
+
+/*! Records that a lock of class STAT was held for HELD nanoseconds. */
+void lockstat_record_hold(struct lockstat *stat, int64_t held) {
+    enum intr_level old_level = intr_disable();
+
+    stat->hold_total += held;
+    intr_set_level(old_level);
+}
+
+/*! Copies the statistics of up to MAX lock classes into STATS, most
+    contended first, skipping classes that were never acquired.  Returns the
+    number of classes copied. */
+int lockstat_top(struct lockstat *stats, int max) {
+    bool taken[LOCKSTAT_CLASSES];
+    enum intr_level old_level;
+    int cnt, i, best;
+
+    memset(taken, 0, sizeof taken);
+    old_level = intr_disable();
+    for (cnt = 0; cnt < max; cnt++) {
+        best = -1;
+        for (i = 0; i < class_cnt; i++) {
+            const struct lockstat *s = &classes[i].stat;
+            if (taken[i] || s->acquisitions == 0)
+                continue;
+            if (best < 0 || s->contended > classes[best].stat.contended ||
+                (s->contended == classes[best].stat.contended &&
+                 s->wait_total > classes[best].stat.wait_total))
+                best = i;
+        }
+        if (best < 0)
+            break;
+        taken[best] = true;
+        stats[cnt] = classes[best].stat;
+    }
+    intr_set_level(old_level);
+    return cnt;
+}
+
+/*! Prints lock statistics, most contended classes first. */
+void lockstat_print(void) {
+    static struct lockstat stats[LOCKSTAT_CLASSES];
+    int cnt, i;
+
+    if (!lockstat_enabled) {
+        printf("Lockstat: not enabled (use -lockstat)\n");
+        return;
+    }
+
+    cnt = lockstat_top(stats, LOCKSTAT_CLASSES);
+    printf("Lockstat: %d lock classes acquired\n", cnt);
+    printf("  %-23s %8s %8s %8s %8s %8s\n", "class", "acq", "contend",
+           "wait(us)", "max(us)", "hold(us)");
+    for (i = 0; i < cnt; i++)
+        printf("  %-23s %8u %8u %8lld %8lld %8lld\n", stats[i].name,
+               stats[i].acquisitions, stats[i].contended,
+               stats[i].wait_total / 1000, stats[i].wait_max / 1000,
+               stats[i].hold_total / 1000);
+}
@@ -0,0 +1,26 @@
+/*! \file lockstat.h
+ *
+ * Declarations for the lock contention profiler.
+ */
+
+#ifndef THREADS_LOCKSTAT_H
+#define THREADS_LOCKSTAT_H
+
+#include <lockstat.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*! Record lock statistics?
+    Controlled by kernel command-line option "-lockstat". */
+extern bool lockstat_enabled;
+
+/*! Number of lock classes that can be tracked, including "(other)". */
+#define LOCKSTAT_CLASSES 64
+
+struct lockstat *lockstat_register(const char *name);
+void lockstat_record(struct lockstat *, bool contended, int64_t waited);
+void lockstat_record_hold(struct lockstat *, int64_t held);
+int lockstat_top(struct lockstat *, int max);
+void lockstat_print(void);
+
+#endif /* threads/lockstat.h */
@@ -21,6 +21,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -30,6 +31,8 @@ struct pool {
     struct lock lock;                   /*!< Mutual exclusion. */
     struct bitmap *used_map;            /*!< Bitmap of free pages. */
     uint8_t *base;                      /*!< Base of pool. */
+    size_t page_cnt;                    /*!< Number of pages in pool. */
+    size_t free_cnt;                    /*!< Number of free pages. */
 };
 
 /*! Two pools: one for kernel data, one for user pages. */
@@ -38,6 +41,7 @@ static struct pool kernel_pool, user_pool;
 static void init_pool(struct pool *, void *base, size_t page_cnt,
                       const char *name);
 static bool page_from_pool(const struct pool *, void *page);
+static void adjust_free_cnt(struct pool *, size_t add, size_t sub);
 
 /*! Initializes the page allocator.  At most USER_PAGE_LIMIT
     pages are put into the user pool. */
@@ -76,8 +80,10 @@ void * palloc_get_multiple(enum palloc_flags flags, size_t page_cnt) {
     page_idx = bitmap_scan_and_flip(pool->used_map, 0, page_cnt, false);
     lock_release(&pool->lock);
 
-    if (page_idx != BITMAP_ERROR)
+    if (page_idx != BITMAP_ERROR) {
         pages = pool->base + PGSIZE * page_idx;
+        adjust_free_cnt(pool, 0, page_cnt);
+    }
     else
         pages = NULL;
 
@@ -128,6 +134,7 @@ void palloc_free_multiple(void *pages, size_t page_cnt) {
 
     ASSERT(bitmap_all(pool->used_map, page_idx, page_cnt));
     bitmap_set_multiple(pool->used_map, page_idx, page_cnt, false);
+    adjust_free_cnt(pool, page_cnt, 0);
 }
 
 /*! Frees the page at PAGE. */
@@ -135,6 +142,26 @@ void palloc_free_page(void *page) {
     palloc_free_multiple(page, 1);
 }
 
+/*! Returns the number of pages in the user pool. */
+size_t palloc_user_page_cnt(void) {
+    return user_pool.page_cnt;
+}
+
+/*! Returns the number of free pages in the user pool.  The count may be
+    stale by the time the caller looks at it. */
+size_t palloc_user_free_cnt(void) {
+    return user_pool.free_cnt;
+}
+
+/*! Adds ADD to and subtracts SUB from POOL's count of free pages.  Pages
+    may be freed with interrupts off, where the pool lock cannot be taken,
+    so the count is protected by disabling interrupts instead. */
+static void adjust_free_cnt(struct pool *pool, size_t add, size_t sub) {
+    enum intr_level old_level = intr_disable();
+    pool->free_cnt = pool->free_cnt + add - sub;
+    intr_set_level(old_level);
+}
+
 /*! Initializes pool P as starting at START and ending at END,
     naming it NAME for debugging purposes. */
 static void init_pool(struct pool *p, void *base, size_t page_cnt,
@@ -153,6 +180,8 @@ static void init_pool(struct pool *p, void *base, size_t page_cnt,
     lock_init(&p->lock);
     p->used_map = bitmap_create_in_buf(page_cnt, base, bm_pages * PGSIZE);
     p->base = base + bm_pages * PGSIZE;
+    p->page_cnt = page_cnt;
+    p->free_cnt = page_cnt;
 }
 
 /*! Returns true if PAGE was allocated from POOL, false otherwise. */
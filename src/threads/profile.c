@@ -0,0 +1,207 @@
+/*! \file profile.c
+ *
+ * Timer-driven sampling profiler.
+ *
+ * Every profile_interval timer ticks, the timer interrupt handler passes
+ * the frame of the code it interrupted to profile_tick(), which records
+ * where that code was: the interrupted EIP, followed by as many return
+ * addresses as can be found by following the saved frame pointers, up to
+ * PROFILE_DEPTH addresses in all.  Together with the running thread and
+ * whether it was in user or kernel mode, those addresses key a hash table
+ * that counts identical samples.  The table is allocated at boot when the
+ * "-profile" option is given, so sampling never allocates memory; once it
+ * is full, samples with new keys are only counted as dropped.
+ *
+ * At shutdown each entry is printed as a "Profile sample:" line, which
+ * `backtrace --profile' turns into a flat profile or folded stacks.
+ */
+
+#include "threads/profile.h"
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/pagedir.h"
+#endif
+
+/*! Pages in the sample table. */
+#define PROFILE_PAGES 32
+
+/*! Maximum addresses recorded per sample, including the EIP. */
+#define PROFILE_DEPTH 8
+
+/*! Samples with the same thread, mode and call stack. */
+struct profile_entry {
+    unsigned count;                     /*!< Number of samples, 0 if free. */
+    tid_t tid;                          /*!< Running thread. */
+    char name[16];                      /*!< Its name. */
+    bool user;                          /*!< Interrupted in user mode? */
+    uint8_t depth;                      /*!< Number of addresses in PC. */
+    uint32_t pc[PROFILE_DEPTH];         /*!< EIP, then return addresses. */
+};
+
+static struct profile_entry *entries;   /*!< Hash table. */
+static size_t entry_cnt;                /*!< Number of slots in ENTRIES. */
+static size_t used_cnt;                 /*!< Number of slots in use. */
+
+/* Statistics. */
+static unsigned long long kernel_samples, user_samples, dropped_samples;
+
+/*! Timer ticks until the next sample. */
+static int countdown;
+
+/*! Timer ticks between samples, or 0 if the profiler is off. */
+int profile_interval;
+
+/*! Allocates the sample table, if profiling was requested. */
+void profile_init(void) {
+    if (profile_interval == 0)
+        return;
+
+    entries = palloc_get_multiple(PAL_ASSERT | PAL_ZERO, PROFILE_PAGES);
+    entry_cnt = PROFILE_PAGES * PGSIZE / sizeof *entries;
+    countdown = profile_interval;
+}
+
+/*! Returns the kernel address of the two words at user address UFRAME
+    in the current process, or a null pointer if they are not mapped. */
+static uint32_t *user_frame(uint32_t uframe UNUSED) {
+#ifdef USERPROG
+    struct thread *t = thread_current();
+
+    if (uframe == 0 || uframe % 4 != 0 || pg_ofs((void *) uframe) > PGSIZE - 8
+        || !is_user_vaddr((void *) uframe) || t->pagedir == NULL)
+        return NULL;
+    return pagedir_get_page(t->pagedir, (void *) uframe);
+#else
+    return NULL;
+#endif
+}
+
+/*! Returns the address of the two words at kernel address KFRAME, or a
+    null pointer if KFRAME does not lie on the current thread's stack. */
+static uint32_t *kernel_frame(uint32_t kframe) {
+    void *base = pg_round_down(thread_current());
+
+    if (kframe % 4 != 0 || pg_round_down((void *) kframe) != base
+        || (void *) kframe < base + sizeof (struct thread)
+        || pg_ofs((void *) kframe) > PGSIZE - 8)
+        return NULL;
+    return (uint32_t *) kframe;
+}
+
+/*! Fills PC with the EIP from interrupt frame F and the return addresses
+    found by following F's frame pointers.  Returns the number of
+    addresses stored. */
+static int unwind(const struct intr_frame *f, bool user,
+                  uint32_t pc[PROFILE_DEPTH]) {
+    uint32_t ebp = f->ebp;
+    int depth = 0;
+
+    pc[depth++] = (uint32_t) f->eip;
+    while (depth < PROFILE_DEPTH) {
+        uint32_t *frame = user ? user_frame(ebp) : kernel_frame(ebp);
+        if (frame == NULL || frame[1] == 0)
+            break;
+        pc[depth++] = frame[1];
+
+        /* Frames must move up the stack, or we could loop forever. */
+        if (frame[0] <= ebp)
+            break;
+        ebp = frame[0];
+    }
+    return depth;
+}
+
+/*! Counts TICKS more timer ticks and, if a sample is due, records the
+    code interrupted by timer interrupt frame F. */
+void profile_tick(struct intr_frame *f, int ticks) {
+    struct thread *t;
+    struct profile_entry *e;
+    uint32_t pc[PROFILE_DEPTH];
+    bool user;
+    int depth;
+    unsigned hash;
+    size_t i;
+
+    ASSERT(intr_context());
+
+    if (entries == NULL)
+        return;
+    countdown -= ticks;
+    if (countdown > 0)
+        return;
+    countdown = profile_interval;
+
+    t = thread_current();
+    user = (f->cs & 3) == 3;            /* Privilege level 3? */
+    depth = unwind(f, user, pc);
+    if (user)
+        user_samples++;
+    else
+        kernel_samples++;
+
+    hash = hash_bytes(pc, depth * sizeof *pc) ^ hash_int(t->tid) ^ user;
+    for (i = hash % entry_cnt; ; i = (i + 1) % entry_cnt) {
+        e = &entries[i];
+        if (e->count == 0)
+            break;
+        if (e->tid == t->tid && e->user == user && e->depth == depth
+            && !memcmp(e->pc, pc, depth * sizeof *pc)) {
+            e->count++;
+            return;
+        }
+    }
+
+    /* Keep a free slot, so that lookups always terminate. */
+    if (used_cnt + 1 >= entry_cnt) {
+        dropped_samples++;
+        return;
+    }
+    used_cnt++;
+    e->count = 1;
+    e->tid = t->tid;
+    strlcpy(e->name, t->name, sizeof e->name);
+    e->user = user;
+    e->depth = depth;
+    memcpy(e->pc, pc, depth * sizeof *pc);
+}
+
+/*! Prints the samples recorded so far, one line per hash table entry,
+    in the format read by `backtrace --profile'. */
+void profile_print(void) {
+    size_t i;
+
+    if (entries == NULL)
+        return;
+
+    printf("Profile: %llu kernel samples, %llu user samples, "
+           "%llu dropped, every %d ticks.\n",
+           kernel_samples, user_samples, dropped_samples, profile_interval);
+    for (i = 0; i < entry_cnt; i++) {
+        struct profile_entry *e = &entries[i];
+        char *p;
+        int j;
+
+        if (e->count == 0)
+            continue;
+
+        /* Keep the line easy to split into words. */
+        for (p = e->name; *p != '\0'; p++)
+            if (*p == ' ')
+                *p = '_';
+
+        printf("Profile sample: %u %d %s %s", e->count, e->tid,
+               e->name[0] != '\0' ? e->name : "-", e->user ? "user" : "kernel");
+        for (j = 0; j < e->depth; j++)
+            printf(" %#"PRIx32, e->pc[j]);
+        printf("\n");
+    }
+}
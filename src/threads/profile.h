@@ -0,0 +1,21 @@
+/*! \file profile.h
+ *
+ * Declarations for the sampling profiler.
+ */
+
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+
+struct intr_frame;
+
+/*! Timer ticks between samples, or 0 if the profiler is off.
+    Controlled by kernel command-line option "-profile". */
+extern int profile_interval;
+
+void profile_init(void);
+void profile_tick(struct intr_frame *, int ticks);
+void profile_print(void);
+
+#endif /* threads/profile.h */
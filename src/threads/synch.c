@@ -35,12 +35,36 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
-#include "threads/palloc.h"
+#include "threads/lockstat.h"
 #include "threads/thread.h"
 
+static int max_waiter_priority(struct semaphore *sema);
+static void donate_priority(struct lock *lock, int priority);
+static void lock_take(struct lock *lock);
+static void waiter_requeue(struct thread *t);
 
-/* Declare pri_donation_list struct from the header file definition */
-extern struct list pri_donation_list;
+/*! One semaphore in a condition variable's wait queue. */
+struct semaphore_elem {
+    struct rb_node node;                /*!< Tree node. */
+    struct semaphore semaphore;         /*!< This semaphore. */
+    struct condition *cond;             /*!< Condition variable waited on. */
+    struct thread *thread;              /*!< The waiting thread. */
+    int priority;                       /*!< Waiter's effective priority. */
+};
+
+/*! Orders a semaphore's waiting threads, highest priority first. */
+static bool waiter_less(const struct rb_node *a, const struct rb_node *b,
+                        void *aux UNUSED) {
+    return rb_entry(a, struct thread, wait_node)->wait_pri >
+           rb_entry(b, struct thread, wait_node)->wait_pri;
+}
+
+/*! Orders a condition variable's waiters, highest priority first. */
+static bool cond_waiter_less(const struct rb_node *a, const struct rb_node *b,
+                             void *aux UNUSED) {
+    return rb_entry(a, struct semaphore_elem, node)->priority >
+           rb_entry(b, struct semaphore_elem, node)->priority;
+}
 
 /*! Initializes semaphore SEMA to VALUE.  A semaphore is a
     nonnegative integer along with two atomic operators for
@@ -50,12 +74,17 @@ extern struct list pri_donation_list;
       decrement it.
 
     - up or "V": increment the value (and wake up one waiting
-      thread, if any). */
-void sema_init(struct semaphore *sema, unsigned value) {
+      thread, if any).
+
+    NAME is SEMA's lock statistics class, or NULL to keep no statistics
+    for it. */
+void sema_init_named(struct semaphore *sema, unsigned value,
+                     const char *name) {
     ASSERT(sema != NULL);
 
     sema->value = value;
-    list_init(&sema->waiters);
+    rb_init(&sema->waiters, waiter_less, NULL);
+    sema->stat = name != NULL ? lockstat_register(name) : NULL;
 }
 
 /*! Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -67,18 +96,29 @@ void sema_init(struct semaphore *sema, unsigned value) {
     thread will probably turn interrupts back on. */
 void sema_down(struct semaphore *sema) {
     enum intr_level old_level;
+    bool profile, contended;
+    int64_t start = 0;
 
     ASSERT(sema != NULL);
     ASSERT(!intr_context());
 
+    profile = lockstat_enabled && sema->stat != NULL;
     old_level = intr_disable();
+    contended = sema->value == 0;
+    if (profile && contended)
+        start = timer_now_ns();
     while (sema->value == 0) {
-        /* Insert thread ordered by priority */
-        list_insert_ordered(&sema->waiters, &thread_current()->elem, 
-            &ready_less, NULL);
+        /* Queue by priority; sema_up() takes us off again. */
+        struct thread *cur = thread_current();
+        cur->waiting_sema = sema;
+        cur->wait_pri = effective_priority(cur);
+        rb_insert(&sema->waiters, &cur->wait_node);
         thread_block();
     }
     sema->value--;
+    if (profile)
+        lockstat_record(sema->stat, contended,
+                        contended ? timer_now_ns() - start : 0);
     intr_set_level(old_level);
 }
 
@@ -97,6 +137,8 @@ bool sema_try_down(struct semaphore *sema) {
     if (sema->value > 0) {
         sema->value--;
         success = true; 
+        if (lockstat_enabled && sema->stat != NULL)
+            lockstat_record(sema->stat, false, 0);
     }
     else {
       success = false;
@@ -112,41 +154,26 @@ bool sema_try_down(struct semaphore *sema) {
     This function may be called from an interrupt handler. */
 void sema_up(struct semaphore *sema) {
     enum intr_level old_level;
-    struct list_elem *e;
-    struct thread *max_waiter, *t;
-    int max_pri = -1;
+    struct thread *max_waiter;
 
     ASSERT(sema != NULL);
 
     old_level = intr_disable();
-    if (!list_empty(&sema->waiters)) {
-        /* Find thread with maximum priority that's waiting on this
-         * semaphore
-         */
-        for (e = list_begin(&sema->waiters); e != list_end(&sema->waiters);
-             e = list_next(e)) {
-            t = list_entry(e, struct thread, elem);
-
-            /* Make sure priority makes sense */
-            ASSERT ((effective_priority(t) >= PRI_MIN) && 
-                (effective_priority(t) <= PRI_MAX));
-
-            if (effective_priority(t) > max_pri) {
-                max_pri = effective_priority(t);
-                max_waiter = t;
-            }	
-        }	
-        ASSERT(max_pri != -1);
+    if (!rb_empty(&sema->waiters)) {
+        /* The waiter with maximum priority is first in the queue. */
+        max_waiter = rb_entry(rb_first(&sema->waiters), struct thread,
+                              wait_node);
 
-        list_remove(&max_waiter->elem);
+        rb_remove(&sema->waiters, &max_waiter->wait_node);
+        max_waiter->waiting_sema = NULL;
 
         sema->value++;
 
         /* Unblock that thread, as it's good to go */
         thread_unblock(max_waiter);
 
-        /* If the waiter that just got unblocked has higher priority */
-        if (max_pri >= thread_get_priority()) {
+        /* If the waiter that just got unblocked should run before us */
+        if (thread_should_preempt(max_waiter)) {
 
             /* Context switch to highe rpriority thread */
             if (!intr_context()) {
@@ -209,12 +236,93 @@ static void sema_test_helper(void *sema_) {
    another one "up" it, but with a lock the same thread must both
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
-   instead of a lock. */
-void lock_init(struct lock *lock) {
+   instead of a lock.
+
+   NAME is LOCK's lock statistics class. */
+void lock_init_named(struct lock *lock, const char *name) {
     ASSERT(lock != NULL);
+    ASSERT(name != NULL);
 
     lock->holder = NULL;
-    sema_init(&lock->semaphore, 1);
+    lock->priority = -1;
+    /* The lock keeps its own statistics, which include hold times. */
+    sema_init_named(&lock->semaphore, 1, NULL);
+    lock->stat = lockstat_register(name);
+    lock->acquired_at = 0;
+}
+
+/*! Returns the highest effective priority of the threads waiting on SEMA, or
+    -1 if there are none.  Interrupts must be off. */
+static int max_waiter_priority(struct semaphore *sema) {
+    if (rb_empty(&sema->waiters))
+        return -1;
+    return rb_entry(rb_first(&sema->waiters), struct thread,
+                    wait_node)->wait_pri;
+}
+
+/*! Moves T, which may be waiting on a semaphore, to the place in that
+    semaphore's wait queue that its effective priority now calls for, and
+    likewise in the wait queue of the condition variable the semaphore
+    belongs to.  O(log n) in the length of the queues.  Interrupts must be
+    off. */
+static void waiter_requeue(struct thread *t) {
+    struct semaphore *sema = t->waiting_sema;
+    int priority = effective_priority(t);
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (sema != NULL && t->wait_pri != priority) {
+        rb_remove(&sema->waiters, &t->wait_node);
+        t->wait_pri = priority;
+        rb_insert(&sema->waiters, &t->wait_node);
+    }
+
+    if (t->cond_waiter != NULL && t->cond_waiter->priority != priority) {
+        struct semaphore_elem *waiter = t->cond_waiter;
+        rb_remove(&waiter->cond->waiters, &waiter->node);
+        waiter->priority = priority;
+        rb_insert(&waiter->cond->waiters, &waiter->node);
+    }
+}
+
+/*! Donates PRIORITY through LOCK to its holder and on down the chain of
+    locks that holder, and so on, is itself waiting for.  Stops as soon as a
+    lock already carries a donation at least as high, since everything past
+    it has then been boosted already.  Interrupts must be off. */
+static void donate_priority(struct lock *lock, int priority) {
+    struct thread *holder;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    while (lock != NULL && lock->holder != NULL && lock->priority < priority) {
+        lock->priority = priority;
+        holder = lock->holder;
+        if (holder->donation_priority < priority) {
+            holder->donation_priority = priority;
+            /* If the holder is ready, move it up its run queue; if it is
+               itself waiting, up its wait queue. */
+            thread_requeue(holder);
+            waiter_requeue(holder);
+        }
+        lock = holder->waiting_lock;
+    }
+}
+
+/*! Records that the current thread now holds LOCK, taking on the priorities
+    donated by the threads still waiting for it.  Interrupts must be off. */
+static void lock_take(struct lock *lock) {
+    struct thread *cur = thread_current();
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    lock->holder = cur;
+    list_push_back(&cur->held_locks, &lock->elem);
+    if (lockstat_enabled)
+        lock->acquired_at = timer_now_ns();
+    if (!get_thread_mlfqs()) {
+        lock->priority = max_waiter_priority(&lock->semaphore);
+        cur->donation_priority = max(cur->donation_priority, lock->priority);
+    }
 }
 
 /*! Acquires LOCK, sleeping until it becomes available if
@@ -226,56 +334,36 @@ void lock_init(struct lock *lock) {
     interrupts disabled, but interrupts will be turned back on if
     we need to sleep. */
 void lock_acquire(struct lock *lock) {
-	struct priority_donation_state *pd_state;
-	struct thread *next_donee;
+    struct thread *cur = thread_current();
     enum intr_level old_level;
+    bool contended;
+    int64_t start = 0;
+
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
-//     ASSERT(!lock_held_by_current_thread(lock));
-
-    if(lock_held_by_current_thread(lock)) {
-        ASSERT(0);
-    }
-
+    ASSERT(!lock_held_by_current_thread(lock));
 
-    /* Only do this if we aren't using MLFQS option. */
-    if (!get_thread_mlfqs()) {
-        old_level = intr_disable();
-        /* If this lock is being held by another thread, and
-         * that threads priority is less than current thread's priority,
-         * donate priority to that thread
-         */
-        if ((lock->holder != NULL) && 
-            (effective_priority(lock->holder) < thread_get_priority())) {
-            pd_state = palloc_get_page(PAL_ZERO);
-            if (pd_state == NULL) {
-                thread_yield();
-            }	
-            thread_current()->donee = lock->holder;
-            pd_state->donee = lock->holder;
-            pd_state->lock_desired = lock;
-            pd_state->donor = thread_current();
-            list_push_front(&pri_donation_list, &pd_state->elem);	
-            donate_priority(lock->holder);
-            /* Check if the donee is blocked. If so, then set priorities down
-               the chain the last donee manually. */
-            if (lock->holder->status == THREAD_BLOCKED) {
-                next_donee = lock->holder->donee;
-                /* Iterate through the blocked threaad's donation chain, and set
-                   the priorities of these donees along this chain manually. */
-                while (next_donee != NULL) {
-                    donate_priority(next_donee);
-                    next_donee = next_donee->donee;
-                }
-            }
-        }
-        intr_set_level(old_level);
+    old_level = intr_disable();
+    contended = lock->semaphore.value == 0;
+    if (lockstat_enabled)
+        start = timer_now_ns();
+
+    /* If this lock is being held by another thread, donate our priority to
+       it (and down its chain of donations).  Only do this if we aren't using
+       MLFQS option. */
+    if (lock->holder != NULL) {
+        cur->waiting_lock = lock;
+        if (!get_thread_mlfqs())
+            donate_priority(lock, thread_get_priority());
     }
 
-        
-
     sema_down(&lock->semaphore);
-    lock->holder = thread_current();
+
+    cur->waiting_lock = NULL;
+    lock_take(lock);
+    if (lockstat_enabled)
+        lockstat_record(lock->stat, contended, lock->acquired_at - start);
+    intr_set_level(old_level);
 }
 
 /*! Tries to acquires LOCK and returns true if successful or false
@@ -285,81 +373,61 @@ void lock_acquire(struct lock *lock) {
     This function will not sleep, so it may be called within an
     interrupt handler. */
 bool lock_try_acquire(struct lock *lock) {
+    enum intr_level old_level;
     bool success;
 
     ASSERT(lock != NULL);
     ASSERT(!lock_held_by_current_thread(lock));
 
+    old_level = intr_disable();
     success = sema_try_down(&lock->semaphore);
-    if (success)
-      lock->holder = thread_current();
+    if (success) {
+        lock_take(lock);
+        if (lockstat_enabled)
+            lockstat_record(lock->stat, false, 0);
+    }
+    intr_set_level(old_level);
 
     return success;
 }
 
 /*! Releases LOCK, which must be owned by the current thread.
 
+    The current thread's donated priority is recomputed from the locks it
+    still holds, so this costs O(locks held), not O(donations system-wide).
+
     An interrupt handler cannot acquire a lock, so it does not
     make sense to try to release a lock within an interrupt
     handler. */
 void lock_release(struct lock *lock) {
-    int largest_donated_pri;
-	struct list_elem *e;
-	struct priority_donation_state *cur_state;
-	largest_donated_pri = -1;
+    struct thread *cur = thread_current();
+    struct list_elem *e;
     enum intr_level old_level;
+    int donated = -1;
 
     ASSERT(!intr_context());
     ASSERT(lock != NULL);
     ASSERT(lock_held_by_current_thread(lock));
-    
-    /* If MLFQS option is not enabled, use priority donation. */
-    if (!get_thread_mlfqs()) {
-        old_level = intr_disable();
-
-        /* If the donation list isn't empty */
-        if (!list_empty(&pri_donation_list)) {
-            e = list_begin(&pri_donation_list);
-            while (e != list_end(&pri_donation_list)) {
-                cur_state = list_entry(e, struct priority_donation_state, elem);
-                if (cur_state->lock_desired == lock && 
-                    cur_state->donee == thread_current()) {
-
-                    /* Jump to next one, then delete current, as this
-                     * lock is being released
-                     */
-                    e = list_next(e);
-                    list_remove(&cur_state->elem);
-                    palloc_free_page(cur_state);
-                }
-                else {
-                    e = list_next(e);
-                }
-                
-            }
 
-            /* Set the donated priority of the current thread to the
-             * largest donated priority of all its current donors
-             */
-            for (e = list_begin(&pri_donation_list); 
-                 e != list_end(&pri_donation_list); e = list_next(e)) {
-                cur_state = list_entry(e, struct priority_donation_state, elem);
-                if ((effective_priority(cur_state->donor) > largest_donated_pri) && 
-                        (cur_state->donee == thread_current())) {
-                    largest_donated_pri = effective_priority(cur_state->donor);
-                }
-            }
+    old_level = intr_disable();
 
-            thread_current()->donation_priority = largest_donated_pri;
+    list_remove(&lock->elem);
+    lock->holder = NULL;
+    lock->priority = -1;
+    if (lockstat_enabled)
+        lockstat_record_hold(lock->stat, timer_now_ns() - lock->acquired_at);
+
+    /* If MLFQS option is not enabled, use priority donation. */
+    if (!get_thread_mlfqs()) {
+        for (e = list_begin(&cur->held_locks); e != list_end(&cur->held_locks);
+             e = list_next(e)) {
+            donated = max(donated, list_entry(e, struct lock, elem)->priority);
         }
-        intr_set_level(old_level);
+        cur->donation_priority = donated;
     }
 
-    lock->holder = NULL;
-	/* If this thread donated to another thread, then its donee will be reset
-	   back to NULL (default value). */
-	thread_current()->donee = NULL;
     sema_up(&lock->semaphore);
+    intr_set_level(old_level);
 }
 
 /*! Returns true if the current thread holds LOCK, false
@@ -371,19 +439,13 @@ bool lock_held_by_current_thread(const struct lock *lock) {
     return lock->holder == thread_current();
 }
 
-/*! One semaphore in a list. */
-struct semaphore_elem {
-    struct list_elem elem;              /*!< List element. */
-    struct semaphore semaphore;         /*!< This semaphore. */
-};
-
 /*! Initializes condition variable COND.  A condition variable
     allows one piece of code to signal a condition and cooperating
     code to receive the signal and act upon it. */
 void cond_init(struct condition *cond) {
     ASSERT(cond != NULL);
 
-    list_init(&cond->waiters);
+    rb_init(&cond->waiters, cond_waiter_less, NULL);
 }
 
 /*! Atomically releases LOCK and waits for COND to be signaled by
@@ -407,6 +469,7 @@ void cond_init(struct condition *cond) {
     interrupts disabled, but interrupts will be turned back on if
     we need to sleep. */
 void cond_wait(struct condition *cond, struct lock *lock) {
+    struct thread *cur = thread_current();
     struct semaphore_elem waiter;
     enum intr_level old_level;
 
@@ -418,8 +481,14 @@ void cond_wait(struct condition *cond, struct lock *lock) {
     ASSERT(lock_held_by_current_thread(lock));
   
     sema_init(&waiter.semaphore, 0);
-    list_push_back(&cond->waiters, &waiter.elem);
+    waiter.cond = cond;
+    waiter.thread = cur;
+    waiter.priority = effective_priority(cur);
+    rb_insert(&cond->waiters, &waiter.node);
+    cur->cond_waiter = &waiter;
     lock_release(lock);
+    /* Releasing LOCK may have taken away a donation. */
+    waiter_requeue(cur);
     sema_down(&waiter.semaphore);
     lock_acquire(lock);
 
@@ -434,12 +503,7 @@ void cond_wait(struct condition *cond, struct lock *lock) {
     make sense to try to signal a condition variable within an
     interrupt handler. */
 void cond_signal(struct condition *cond, struct lock *lock UNUSED) {
-	struct list_elem *e;
-	struct semaphore *s;
-	struct thread *t;
-    struct semaphore_elem *max_sem_elem;
-	int max_pri = -1;
-	struct semaphore *max_sem;
+    struct semaphore_elem *waiter;
     enum intr_level old_level;
 
     ASSERT(cond != NULL);
@@ -449,27 +513,13 @@ void cond_signal(struct condition *cond, struct lock *lock UNUSED) {
 
     old_level = intr_disable();
 
-    /* Loop through all waiters and wake up the waiter with the
-     * highest priority. We can't guarantee that this list is sorted
-     * as it may have changed in the meantime
-     */
-    if (!list_empty(&cond->waiters)) {
-        for (e = list_begin(&cond->waiters); e != list_end(&cond->waiters);
-             e = list_next(e)) {
-            s = &list_entry(e, struct semaphore_elem, elem)->semaphore;
-            if (!list_empty(&s->waiters)) {
-                t = list_entry(list_begin(&s->waiters), struct thread, elem);
-                if (effective_priority(t) > max_pri) {
-                    max_pri = effective_priority(t);
-                    max_sem = s;
-                    max_sem_elem = list_entry(e, struct semaphore_elem, elem);
-                }	
-            }
-        }	
-        ASSERT(max_pri != -1);
-        /* Signal to the highest priority thread. */
-        list_remove(max_sem_elem);
-        sema_up(max_sem);
+    /* Signal to the highest priority waiter, first in the queue. */
+    if (!rb_empty(&cond->waiters)) {
+        waiter = rb_entry(rb_first(&cond->waiters), struct semaphore_elem,
+                          node);
+        rb_remove(&cond->waiters, &waiter->node);
+        waiter->thread->cond_waiter = NULL;
+        sema_up(&waiter->semaphore);
     }
 
     intr_set_level(old_level);
@@ -485,7 +535,112 @@ void cond_broadcast(struct condition *cond, struct lock *lock) {
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
 
-    while (!list_empty(&cond->waiters))
+    while (!rb_empty(&cond->waiters))
         cond_signal(cond, lock);
 }
 
+
+/*! Initializes RW as unheld.
+
+    If PREFER_WRITERS is true, a writer that is waiting for the current
+    readers to leave keeps new readers out, so writers cannot be starved.
+    Otherwise new readers may join readers that are already active even
+    when a writer is waiting, which favors read throughput.
+
+    A writer owns RW's inner lock while it waits and while it writes, so a
+    reader or writer that blocks behind it donates its priority to it.  The
+    readers themselves hold no lock, so a writer waiting for them to leave
+    does not donate to them. */
+void rwlock_init(struct rwlock *rw, bool prefer_writers) {
+    ASSERT(rw != NULL);
+
+    lock_init(&rw->lock);
+    sema_init(&rw->drained, 0);
+    rw->readers = 0;
+    rw->writer_waiting = false;
+    rw->prefer_writers = prefer_writers;
+}
+
+/*! Acquires RW for reading, sleeping until no writer holds it.  Any number
+    of threads may hold RW for reading at once.
+
+    This function may sleep, so it must not be called within an
+    interrupt handler. */
+void rwlock_read_acquire(struct rwlock *rw) {
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+    ASSERT(!lock_held_by_current_thread(&rw->lock));
+
+    old_level = intr_disable();
+    if (!rw->prefer_writers && rw->readers > 0) {
+        /* Readers are active, so no writer is writing; join them. */
+        rw->readers++;
+        intr_set_level(old_level);
+        return;
+    }
+    intr_set_level(old_level);
+
+    /* Pass through the writer's lock, donating to the writer if there is
+       one. */
+    lock_acquire(&rw->lock);
+    old_level = intr_disable();
+    rw->readers++;
+    intr_set_level(old_level);
+    lock_release(&rw->lock);
+}
+
+/*! Releases RW, which the current thread must hold for reading. */
+void rwlock_read_release(struct rwlock *rw) {
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+
+    old_level = intr_disable();
+    ASSERT(rw->readers > 0);
+    if (--rw->readers == 0 && rw->writer_waiting) {
+        rw->writer_waiting = false;
+        sema_up(&rw->drained);
+    }
+    intr_set_level(old_level);
+}
+
+/*! Acquires RW for writing, sleeping until no other thread holds it for
+    reading or writing.
+
+    This function may sleep, so it must not be called within an
+    interrupt handler. */
+void rwlock_write_acquire(struct rwlock *rw) {
+    enum intr_level old_level;
+
+    ASSERT(rw != NULL);
+    ASSERT(!intr_context());
+
+    lock_acquire(&rw->lock);
+
+    /* Holding the lock keeps out readers that have not started yet (unless
+       they may join active readers); wait for the active ones to leave. */
+    old_level = intr_disable();
+    while (rw->readers > 0) {
+        rw->writer_waiting = true;
+        sema_down(&rw->drained);
+    }
+    intr_set_level(old_level);
+}
+
+/*! Releases RW, which the current thread must hold for writing. */
+void rwlock_write_release(struct rwlock *rw) {
+    ASSERT(rw != NULL);
+    ASSERT(rw->readers == 0);
+
+    lock_release(&rw->lock);
+}
+
+/*! Returns true if the current thread holds RW for writing, false
+    otherwise. */
+bool rwlock_write_held_by_current_thread(const struct rwlock *rw) {
+    ASSERT(rw != NULL);
+
+    return lock_held_by_current_thread(&rw->lock);
+}
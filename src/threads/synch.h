@@ -8,15 +8,23 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <rbtree.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 /*! A counting semaphore. */
 struct semaphore {
     unsigned value;             /*!< Current value. */
-    struct list waiters;        /*!< List of waiting threads. */
+    struct rb_tree waiters;     /*!< Waiting threads, highest effective
+                                     priority first, FIFO among equals. */
+    struct lockstat *stat;      /*!< Contention statistics, or NULL. */
 };
 
-void sema_init(struct semaphore *, unsigned value);
+/*! Initializes SEMA, naming its lock statistics class after the SEMA
+    expression.  Use sema_init_named() to choose the name. */
+#define sema_init(SEMA, VALUE) sema_init_named(SEMA, VALUE, #SEMA)
+
+void sema_init_named(struct semaphore *, unsigned value, const char *name);
 void sema_down(struct semaphore *);
 bool sema_try_down(struct semaphore *);
 void sema_up(struct semaphore *);
@@ -26,9 +34,19 @@ void sema_self_test(void);
 struct lock {
     struct thread *holder;      /*!< Thread holding lock (for debugging). */
     struct semaphore semaphore; /*!< Binary semaphore controlling access. */
+    int priority;               /*!< Highest priority donated by a waiter,
+                                     -1 if none. */
+    struct list_elem elem;      /*!< Element in holder's held_locks. */
+    struct lockstat *stat;      /*!< Contention statistics, or NULL. */
+    int64_t acquired_at;        /*!< When the holder acquired the lock,
+                                     in timer_now_ns() nanoseconds. */
 };
 
-void lock_init(struct lock *);
+/*! Initializes LOCK, naming its lock statistics class after the LOCK
+    expression.  Use lock_init_named() to choose the name. */
+#define lock_init(LOCK) lock_init_named(LOCK, #LOCK)
+
+void lock_init_named(struct lock *, const char *name);
 void lock_acquire(struct lock *);
 bool lock_try_acquire(struct lock *);
 void lock_release(struct lock *);
@@ -36,7 +54,8 @@ bool lock_held_by_current_thread(const struct lock *);
 
 /*! Condition variable. */
 struct condition {
-    struct list waiters;        /*!< List of waiting threads. */
+    struct rb_tree waiters;     /*!< Waiters' semaphores, ordered like a
+                                     semaphore's waiters. */
 };
 
 void cond_init(struct condition *);
@@ -44,7 +63,23 @@ void cond_wait(struct condition *, struct lock *);
 void cond_signal(struct condition *, struct lock *);
 void cond_broadcast(struct condition *, struct lock *);
 
-bool cond_less(struct list_elem *elem1, struct list_elem *elem2, void *aux);
+/*! Reader-writer lock.  A writer holds LOCK for as long as it writes, so
+    readers and writers that block behind it donate their priority to it
+    through the usual lock donation. */
+struct rwlock {
+    struct lock lock;           /*!< Held by the writer, if any. */
+    struct semaphore drained;   /*!< Upped when the last reader leaves. */
+    unsigned readers;           /*!< Number of threads reading. */
+    bool writer_waiting;        /*!< Writer waiting for readers to leave? */
+    bool prefer_writers;        /*!< Block new readers behind a writer? */
+};
+
+void rwlock_init(struct rwlock *, bool prefer_writers);
+void rwlock_read_acquire(struct rwlock *);
+void rwlock_read_release(struct rwlock *);
+void rwlock_write_acquire(struct rwlock *);
+void rwlock_write_release(struct rwlock *);
+bool rwlock_write_held_by_current_thread(const struct rwlock *);
 
 /*! Optimization barrier.
 
@@ -2,15 +2,19 @@
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpugroup.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
+#include "threads/irqsoff.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "filesys/file.h"
 #include "userprog/process.h"
@@ -25,19 +29,31 @@
     of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/*! List of processes in THREAD_READY state, that is, processes
-    that are ready to run but not actually running. */
-static struct list ready_list;
-
-/*! List of processes in THREAD_BLOCKED state and sleeping,
-    that is, blocked processes that should be woken up after
-    at a specified time. */
-static struct list sleep_list;
+/*! Run queue of processes in THREAD_READY state, that is, processes
+    that are ready to run but not actually running.  Indexed by effective
+    priority; see struct ready_queue. */
+static struct ready_queue ready_queue;
 
 /*! List of all processes.  Processes are added to this list
     when they are first scheduled and removed when they exit. */
 struct list all_list;
 
+/*! Live threads hashed by tid, for thread_lookup().  Like all_list, the
+    chains are only modified with interrupts off and may be walked inside
+    rcu_read_lock() instead. */
+#define TID_TABLE_SIZE 128
+static struct list tid_table[TID_TABLE_SIZE];
+
+/*! Epoch-based deferred freeing of dead threads.  A reader entering a
+    read-side section counts itself against the current epoch's parity.  A
+    dying thread's page is retired to the list of the epoch it died in.  The
+    epoch only advances once every reader of the previous epoch has left,
+    and pages retired two epochs ago are then no longer reachable by anyone
+    and can be freed. */
+static unsigned rcu_epoch;
+static int rcu_readers[2];
+static struct list rcu_retired[3];
+
 /* List of processes being created */
 // extern struct list starting_list;
 
@@ -54,9 +70,6 @@ struct list dead_list;
 extern struct lock frame_lock;
 #endif
 
-/* Declare pri_donation_list struct from the header file definition */
-struct list pri_donation_list;
-
 /*! Idle thread. */
 static struct thread *idle_thread;
 
@@ -78,12 +91,38 @@ static long long idle_ticks;    /*!< # of timer ticks spent idle. */
 static long long kernel_ticks;  /*!< # of timer ticks in kernel threads. */
 static long long user_ticks;    /*!< # of timer ticks in user programs. */
 
+/*! Scheduler statistics summed over every thread, including those that
+    have exited. */
+static struct schedstat schedstat_totals;
+
 /* Global system load average. Initialized to zero. */
 static fixedpt load_avg = 0;
 
+/*! Number of seconds of recent_cpu decay coefficients remembered.  A thread
+    that has missed more decays than this (because it was blocked) has the
+    excess applied in closed form using the oldest remembered coefficient. */
+#define DECAY_HISTORY 16
+
+/*! Number of once-per-second recent_cpu decays performed so far, and the
+    coefficient used by each of the last DECAY_HISTORY of them (decay N used
+    decay_coeffs[N % DECAY_HISTORY]).  The running and ready threads are
+    decayed at once; a blocked thread catches up, by catch_up_recent_cpu(),
+    when it is woken. */
+static unsigned decays_done;
+static fixedpt decay_coeffs[DECAY_HISTORY];
+
 static void recalculate_priority(struct thread *t);
-static void recalculate_recent_cpu(struct thread *t);
+static void catch_up_recent_cpu(struct thread *t);
+static void decay_recent_cpu(void);
 static void recalculate_load_avg(void);
+static void mlfqs_softirq(void);
+
+static void ready_queue_init(struct ready_queue *rq);
+static void ready_queue_push(struct thread *t);
+static void ready_queue_remove(struct thread *t);
+static struct thread *ready_queue_pop(void);
+static int ready_queue_max(void);
+static int ready_queue_count(void);
 
 /* Scheduling. */
 #define TIME_SLICE 4            /*!< # of timer ticks to give each thread. */
@@ -94,7 +133,58 @@ static unsigned thread_ticks;   /*!< # of timer ticks since last yield. */
     Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/*! If true, use the completely fair scheduler.
+    Controlled by kernel command-line option "-cfs". */
+bool thread_cfs;
+
+/* Completely fair scheduler.  Ready threads are kept in a red-black tree
+   ordered by vruntime, their run time scaled inversely by a weight derived
+   from their nice value, and the thread with the least vruntime runs next.
+   Instead of a fixed time slice, every ready thread gets a share of
+   CFS_LATENCY proportional to its weight. */
+#define CFS_NICE0_WEIGHT 1024   /*!< Weight of a thread with nice 0. */
+#define CFS_LATENCY 8           /*!< Ticks in which every ready thread
+                                     should get to run once. */
+#define CFS_MIN_GRANULARITY 1   /*!< Minimum slice, in ticks. */
+
+/*! One tick of run time at nice 0, in vruntime units. */
+#define CFS_TICK_VRUNTIME CFS_NICE0_WEIGHT
+
+/*! Weight for each nice value from NICE_MIN to NICE_MAX.  Each step in nice
+    is worth about 10% of CPU time relative to a competing thread. */
+static const int cfs_nice_weights[NICE_MAX - NICE_MIN + 1] = {
+    88761, 71755, 56483, 46273, 36291, 29154, 23254, 18705, 14949, 11916,
+     9548,  7620,  6100,  4904,  3906,  3121,  2501,  1991,  1586,  1277,
+     1024,   820,   655,   526,   423,   335,   272,   215,   172,   137,
+      110,    87,    70,    56,    45,    36,    29,    23,    18,    15,
+       12,
+};
+
+/* Earliest-deadline-first class.  A thread in this class is given a
+   budget of edf_runtime ticks in every period of edf_period ticks, due
+   edf_deadline ticks after the period starts.  While it has budget left,
+   it runs ahead of every thread outside the class, and EDF threads run in
+   order of their current deadline.  A thread that uses up its budget is
+   throttled into its normal class until its next period. */
+#define EDF_MAX_BANDWIDTH 900   /*!< Per mille of the CPU that may be
+                                     admitted to the EDF class. */
+
+/*! Total CPU share admitted to the EDF class, per mille. */
+static int edf_total_bandwidth;
+
+static bool edf_less(const struct rb_node *a, const struct rb_node *b,
+                     void *aux);
+static timer_callback_func edf_release;
+static void edf_leave(struct thread *t);
+
+static int cfs_weight(const struct thread *t);
+static bool cfs_less(const struct rb_node *a, const struct rb_node *b,
+                     void *aux);
+static void cfs_update_min_vruntime(void);
+static unsigned cfs_slice(struct thread *t);
+
 static void kernel_thread(thread_func *, void *aux);
+static timer_callback_func thread_wake;
 
 static void idle(void *aux UNUSED);
 static struct thread *running_thread(void);
@@ -102,9 +192,12 @@ static struct thread *next_thread_to_run(void);
 static void init_thread(struct thread *, const char *name, int priority);
 static bool is_thread(struct thread *) UNUSED;
 static void *alloc_frame(struct thread *, size_t size);
+static void tid_table_insert(struct thread *t);
+static void rcu_retire(struct thread *prev);
 static void schedule(void);
 void thread_schedule_tail(struct thread *prev);
 static tid_t allocate_tid(void);
+static void schedstat_account(struct thread *prev, struct thread *cur);
 
 
 /* Calculates the max of two numbers */
@@ -124,10 +217,335 @@ int effective_priority(struct thread *t) {
     }
 }
 
-/* Return max priority of the list */
+/* Return max priority of the ready queue, or -1 if it is empty */
 int max_ready_priority() {
-    return effective_priority(list_entry(list_begin(&ready_list), 
-        struct thread, elem));
+    return ready_queue_max();
+}
+
+/*! Initializes RQ to empty. */
+static void ready_queue_init(struct ready_queue *rq) {
+    int i;
+
+    for (i = 0; i < PRI_CNT; i++)
+        list_init(&rq->levels[i]);
+    memset(rq->bitmap, 0, sizeof rq->bitmap);
+    rq->num_ready = 0;
+    rb_init(&rq->cfs_tree, cfs_less, NULL);
+    rq->min_vruntime = 0;
+    rq->cfs_weight = 0;
+    rb_init(&rq->edf_tree, edf_less, NULL);
+}
+
+/*! Returns the highest priority level with a ready thread on it in RQ, or -1
+    if RQ is empty. */
+static int rq_max(const struct ready_queue *rq) {
+    int word;
+
+    for (word = sizeof rq->bitmap / sizeof *rq->bitmap - 1; word >= 0;
+         word--) {
+        if (rq->bitmap[word] != 0)
+            return word * 32 + 31 - __builtin_clz(rq->bitmap[word]);
+    }
+    return -1;
+}
+
+/*! Removes T from whichever level of RQ it is on. */
+static void rq_delete(struct ready_queue *rq, struct thread *t) {
+    int pri = t->ready_pri;
+
+    if (t->edf_queued) {
+        rb_remove(&rq->edf_tree, &t->edf_node);
+        t->edf_queued = false;
+        rq->num_ready--;
+        return;
+    }
+    if (thread_cfs) {
+        rb_remove(&rq->cfs_tree, &t->cfs_node);
+        rq->cfs_weight -= cfs_weight(t);
+        rq->num_ready--;
+        return;
+    }
+
+    list_remove(&t->elem);
+    if (list_empty(&rq->levels[pri]))
+        rq->bitmap[pri / 32] &= ~(1u << (pri % 32));
+    rq->num_ready--;
+}
+
+/*! Appends T to the run queue level for its effective priority, behind any
+    ready threads of the same priority (round-robin order).  Interrupts must
+    be off. */
+static void ready_queue_push(struct thread *t) {
+    struct ready_queue *rq = &ready_queue;
+    int pri = effective_priority(t);
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(pri >= PRI_MIN && pri <= PRI_MAX);
+
+    if (t->edf && !t->edf_throttled) {
+        rb_insert(&rq->edf_tree, &t->edf_node);
+        t->edf_queued = true;
+    } else if (thread_cfs) {
+        rb_insert(&rq->cfs_tree, &t->cfs_node);
+        rq->cfs_weight += cfs_weight(t);
+    } else {
+        t->ready_pri = pri;
+        list_push_back(&rq->levels[pri], &t->elem);
+        rq->bitmap[pri / 32] |= 1u << (pri % 32);
+    }
+    rq->num_ready++;
+}
+
+/*! Removes T from whichever run queue level it is on.  Interrupts must be
+    off. */
+static void ready_queue_remove(struct thread *t) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    rq_delete(&ready_queue, t);
+}
+
+/*! Returns the highest priority level with a ready thread on it, or -1 if
+    the run queue is empty.  A ready EDF thread counts as PRI_MAX. */
+static int ready_queue_max(void) {
+    if (!rb_empty(&ready_queue.edf_tree))
+        return PRI_MAX;
+    return rq_max(&ready_queue);
+}
+
+/*! Returns the number of ready threads. */
+static int ready_queue_count(void) {
+    return ready_queue.num_ready;
+}
+
+/*! Removes and returns the thread at the head of the highest priority
+    non-empty level of the run queue, or NULL if it is empty.  Interrupts
+    must be off. */
+static struct thread * ready_queue_pop(void) {
+    struct ready_queue *rq = &ready_queue;
+    struct thread *t = NULL;
+    int pri;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!rb_empty(&rq->edf_tree)) {
+        t = rb_entry(rb_first(&rq->edf_tree), struct thread, edf_node);
+        rq_delete(rq, t);
+    } else if (thread_cfs) {
+        if (!rb_empty(&rq->cfs_tree)) {
+            t = rb_entry(rb_first(&rq->cfs_tree), struct thread, cfs_node);
+            rq_delete(rq, t);
+        }
+    } else {
+        pri = rq_max(rq);
+        if (pri >= 0) {
+            t = list_entry(list_front(&rq->levels[pri]), struct thread, elem);
+            rq_delete(rq, t);
+        }
+    }
+    return t;
+}
+
+/*! Moves T to the run queue level matching its current effective priority.
+    Must be called whenever the effective priority of a thread that may be
+    ready changes (donation, MLFQS recalculation).  Does nothing if T is not
+    on the run queue. */
+void thread_requeue(struct thread *t) {
+    enum intr_level old_level;
+
+    ASSERT(is_thread(t));
+
+    old_level = intr_disable();
+    /* The CFS and EDF trees are ordered by vruntime and deadline, which
+       priorities do not affect. */
+    if (!thread_cfs && !t->edf_queued && t->status == THREAD_READY &&
+        t != idle_thread &&
+        t->ready_pri != effective_priority(t)) {
+        ready_queue_remove(t);
+        ready_queue_push(t);
+    }
+    intr_set_level(old_level);
+}
+
+/*! Returns the CFS weight of T, from its nice value. */
+static int cfs_weight(const struct thread *t) {
+    ASSERT(t->niceness >= NICE_MIN && t->niceness <= NICE_MAX);
+
+    return cfs_nice_weights[t->niceness - NICE_MIN];
+}
+
+/*! Orders threads in a CFS run queue tree by vruntime. */
+static bool cfs_less(const struct rb_node *a, const struct rb_node *b,
+                     void *aux UNUSED) {
+    return rb_entry(a, struct thread, cfs_node)->vruntime <
+           rb_entry(b, struct thread, cfs_node)->vruntime;
+}
+
+/*! Advances the run queue's min_vruntime to the least vruntime of the
+    running thread and the ready threads.  min_vruntime never moves backward, so a
+    thread placed relative to it cannot jump ahead of threads that have
+    been waiting.  Interrupts must be off. */
+static void cfs_update_min_vruntime(void) {
+    struct ready_queue *rq = &ready_queue;
+    struct thread *cur = thread_current();
+    int64_t vruntime = INT64_MAX;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (cur != idle_thread)
+        vruntime = cur->vruntime;
+    if (!rb_empty(&rq->cfs_tree)) {
+        struct thread *first = rb_entry(rb_first(&rq->cfs_tree),
+                                        struct thread, cfs_node);
+        if (first->vruntime < vruntime)
+            vruntime = first->vruntime;
+    }
+    if (vruntime != INT64_MAX && vruntime > rq->min_vruntime)
+        rq->min_vruntime = vruntime;
+}
+
+/*! Returns the number of ticks T, which must be running, may run before it
+    is preempted: its weighted share of a scheduling period that is
+    CFS_LATENCY ticks long, or longer if there are too many ready threads to
+    give each CFS_MIN_GRANULARITY within that. */
+static unsigned cfs_slice(struct thread *t) {
+    struct ready_queue *rq = &ready_queue;
+    int nr_running = rq->num_ready + 1;
+    int64_t period = CFS_LATENCY;
+    int64_t slice;
+
+    if (nr_running > CFS_LATENCY / CFS_MIN_GRANULARITY)
+        period = (int64_t) nr_running * CFS_MIN_GRANULARITY;
+    slice = period * cfs_weight(t) / (rq->cfs_weight + cfs_weight(t));
+    return slice > CFS_MIN_GRANULARITY ? slice : CFS_MIN_GRANULARITY;
+}
+
+/*! Returns true if T, which has just become ready, should preempt the
+    running thread.  An EDF thread with budget left preempts any thread
+    outside the EDF class and any EDF thread with a later deadline.
+    Otherwise, under CFS, T preempts if it has run at least a tick's worth
+    of vruntime less; under the other schedulers, if its priority is at
+    least as high. */
+bool thread_should_preempt(struct thread *t) {
+    struct thread *cur = thread_current();
+    bool t_edf = t->edf && !t->edf_throttled;
+    bool cur_edf = cur->edf && !cur->edf_throttled;
+
+    if (cur == idle_thread)
+        return true;
+    if (t_edf || cur_edf)
+        return t_edf && (!cur_edf ||
+                         t->edf_abs_deadline < cur->edf_abs_deadline);
+    if (thread_cfs)
+        return t->vruntime + CFS_TICK_VRUNTIME < cur->vruntime;
+    return effective_priority(t) >= thread_get_priority();
+}
+
+/*! Orders threads in an EDF run queue tree by current deadline. */
+static bool edf_less(const struct rb_node *a, const struct rb_node *b,
+                     void *aux UNUSED) {
+    return rb_entry(a, struct thread, edf_node)->edf_abs_deadline <
+           rb_entry(b, struct thread, edf_node)->edf_abs_deadline;
+}
+
+/*! Starts a new period for EDF thread T_: counts a deadline miss if the
+    previous job was still unfinished, refills the budget, sets the new
+    deadline and moves T back into the EDF class if it was throttled.
+    Runs in the timer interrupt. */
+static void edf_release(void *t_) {
+    struct thread *t = t_;
+    int64_t now = timer_ticks();
+    bool ready = t->status == THREAD_READY;
+
+    ASSERT(t->edf);
+
+    /* A job that neither blocked nor ran out of budget was still waiting
+       for the CPU, or still running, when its deadline passed. */
+    if (t->status != THREAD_BLOCKED && !t->edf_throttled && !t->edf_missed) {
+        t->stats.deadline_misses++;
+        schedstat_totals.deadline_misses++;
+    }
+
+    if (ready)
+        ready_queue_remove(t);
+    t->edf_throttled = false;
+    t->edf_missed = false;
+    t->edf_budget = t->edf_runtime;
+    t->edf_abs_deadline = now + t->edf_deadline;
+    if (ready) {
+        ready_queue_push(t);
+        if (thread_should_preempt(t))
+            intr_yield_on_return();
+    }
+
+    timer_add(&t->edf_timer, now + t->edf_period, edf_release, t);
+}
+
+/*! Takes T out of the EDF class and releases its bandwidth.  Interrupts
+    must be off and T must not be on a run queue. */
+static void edf_leave(struct thread *t) {
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(!t->edf_queued);
+
+    if (!t->edf)
+        return;
+    timer_cancel(&t->edf_timer);
+    edf_total_bandwidth -= t->edf_bandwidth;
+    t->edf_bandwidth = 0;
+    t->edf = false;
+}
+
+/*! Puts the current thread in the EDF class, to run for RUNTIME ticks in
+    every PERIOD ticks, each time by DEADLINE ticks after the period starts.
+    A RUNTIME of 0 takes the thread back out of the class.
+
+    Admission control keeps the sum of RUNTIME / DEADLINE over all EDF
+    threads within EDF_MAX_BANDWIDTH, so that every admitted thread can meet
+    its deadlines and ordinary threads still get some CPU.  Returns false,
+    leaving the thread's class unchanged, if the parameters are not
+    0 < RUNTIME <= DEADLINE <= PERIOD or the thread cannot be admitted. */
+bool thread_set_edf(int64_t runtime, int64_t deadline, int64_t period) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    int64_t now;
+    int bandwidth;
+
+    ASSERT(!intr_context());
+
+    if (runtime == 0) {
+        old_level = intr_disable();
+        edf_leave(cur);
+        intr_set_level(old_level);
+        /* Let any thread now ahead of us run. */
+        thread_yield();
+        return true;
+    }
+    if (runtime < 0 || runtime > deadline || deadline > period)
+        return false;
+    bandwidth = DIV_ROUND_UP(runtime * 1000, deadline);
+
+    old_level = intr_disable();
+    if (edf_total_bandwidth - cur->edf_bandwidth + bandwidth >
+        EDF_MAX_BANDWIDTH) {
+        intr_set_level(old_level);
+        return false;
+    }
+    if (cur->edf)
+        timer_cancel(&cur->edf_timer);
+    edf_total_bandwidth += bandwidth - cur->edf_bandwidth;
+
+    now = timer_ticks();
+    cur->edf = true;
+    cur->edf_throttled = false;
+    cur->edf_missed = false;
+    cur->edf_runtime = runtime;
+    cur->edf_deadline = deadline;
+    cur->edf_period = period;
+    cur->edf_bandwidth = bandwidth;
+    cur->edf_budget = runtime;
+    cur->edf_abs_deadline = now + deadline;
+    timer_add(&cur->edf_timer, now + period, edf_release, cur);
+    intr_set_level(old_level);
+    return true;
 }
 
 /*! Initializes the threading system by transforming the code
@@ -142,6 +560,8 @@ int max_ready_priority() {
 
     It is not safe to call thread_current() until this function finishes. */
 void thread_init(void) {
+    int i;
+
     ASSERT(intr_get_level() == INTR_OFF);
 
     lock_init(&tid_lock);
@@ -152,11 +572,13 @@ void thread_init(void) {
     lock_init(&frame_lock);
     #endif
 
-    list_init(&ready_list);
-
-    list_init(&sleep_list);
+    ready_queue_init(&ready_queue);
     list_init(&all_list);
-    list_init(&pri_donation_list);
+    for (i = 0; i < TID_TABLE_SIZE; i++)
+        list_init(&tid_table[i]);
+    for (i = 0; i < 3; i++)
+        list_init(&rcu_retired[i]);
+    cpugroup_init();
 
 //     list_init(&starting_list);
 
@@ -169,11 +591,14 @@ void thread_init(void) {
     init_thread(initial_thread, "main", PRI_DEFAULT);
     initial_thread->status = THREAD_RUNNING;
     initial_thread->tid = allocate_tid();
+    tid_table_insert(initial_thread);
 }
 
 /*! Starts preemptive thread scheduling by enabling interrupts.
     Also creates the idle thread. */
 void thread_start(void) {
+    softirq_register(SOFTIRQ_SCHED, mlfqs_softirq, "sched");
+
     /* Create the idle thread. */
     struct semaphore idle_started;
     sema_init(&idle_started, 0);
@@ -192,11 +617,9 @@ void thread_start(void) {
     sema_down(&idle_started);
 }
 
+/*! Recomputes T's MLFQS priority from its recent_cpu and niceness.  T need
+    not be the running thread. */
 static void recalculate_priority(struct thread *t) {
-    ASSERT (thread_get_nice() >= NICE_MIN 
-        && thread_get_nice() <= NICE_MAX);
-    ASSERT (thread_get_priority() >= PRI_MIN 
-        && thread_get_priority() <= PRI_MAX);
     ASSERT (t->priority >= PRI_MIN && t->priority <= PRI_MAX);
     ASSERT (t->niceness >= NICE_MIN && t->niceness <= NICE_MAX);
 
@@ -218,32 +641,101 @@ static void recalculate_priority(struct thread *t) {
         }
     }
         
-    ASSERT (thread_get_priority() >= PRI_MIN 
-        && thread_get_priority() <= PRI_MAX);
     ASSERT (t->priority >= PRI_MIN && t->priority <= PRI_MAX);
     ASSERT (t->niceness >= NICE_MIN && t->niceness <= NICE_MAX);
 }
 
-static void recalculate_recent_cpu(struct thread *t) {
-    ASSERT (t->priority >= PRI_MIN && t->priority <= PRI_MAX);
+/*! Raises X to the nonnegative integer power N, by repeated squaring. */
+static fixedpt fixedpt_pow(fixedpt x, unsigned n) {
+    fixedpt result = int_to_fixedpt(1);
+
+    while (n > 0) {
+        if (n & 1)
+            result = fixedpt_mul(result, x);
+        x = fixedpt_mul(x, x);
+        n >>= 1;
+    }
+    return result;
+}
+
+/*! Applies to T's recent_cpu all of the per-second decays that have happened
+    since it was last brought up to date.  Threads that are blocked are not
+    touched by the per-second update at all; they pay for the decays they
+    missed here, when they are next woken or otherwise examined. */
+static void catch_up_recent_cpu(struct thread *t) {
+    unsigned missed = decays_done - t->decays_seen;
+    fixedpt nice = int_to_fixedpt(t->niceness);
+    fixedpt coeff, coeff_n;
+    unsigned d;
+
+    ASSERT(intr_get_level() == INTR_OFF);
     ASSERT (t->niceness >= NICE_MIN && t->niceness <= NICE_MAX);
-    ASSERT (thread_get_nice() >= NICE_MIN && thread_get_nice() <= NICE_MAX);
+
+    t->decays_seen = decays_done;
 
     /* If not idle */
-    if (t->tid != 2) {
-//     if (strcmp(t->name, "idle") != 0) {
-        /* Calculate recent_cpu, using fixed point arithmetic. */
-        fixedpt fp2 = int_to_fixedpt(2);
-        fixedpt fp1 = int_to_fixedpt(1);
-        fixedpt coeff = fixedpt_div(fixedpt_mul(fp2, load_avg), 
-                                fixedpt_add(fixedpt_mul(fp2, load_avg), fp1));
-        t->recent_cpu = fixedpt_add(fixedpt_mul(coeff, t->recent_cpu), 
-                                int_to_fixedpt(t->niceness)); 
+    if (t->tid == 2 || missed == 0)
+        return;
+
+    if (missed > DECAY_HISTORY) {
+        /* The coefficients for the oldest decays are gone.  Apply the
+           excess using the oldest one we still have, in closed form:
+           k steps of x -> c*x + nice give
+           c^k*x + nice*(1 - c^k)/(1 - c). */
+        unsigned excess = missed - DECAY_HISTORY;
+        coeff = decay_coeffs[decays_done % DECAY_HISTORY];
+        coeff_n = fixedpt_pow(coeff, excess);
+        t->recent_cpu = fixedpt_add(fixedpt_mul(coeff_n, t->recent_cpu),
+                        fixedpt_div(fixedpt_mul(nice, fixedpt_sub(
+                                        int_to_fixedpt(1), coeff_n)),
+                                    fixedpt_sub(int_to_fixedpt(1), coeff)));
+        missed = DECAY_HISTORY;
+    }
+
+    /* Calculate recent_cpu, using fixed point arithmetic. */
+    for (d = decays_done - missed; d != decays_done; d++) {
+        t->recent_cpu = fixedpt_add(fixedpt_mul(
+                            decay_coeffs[d % DECAY_HISTORY], t->recent_cpu),
+                            nice);
+    }
+}
+
+/*! Performs the once-per-second recent_cpu decay.  Only the running thread
+    and the threads on the run queue, whose priorities the scheduler is about
+    to compare, are updated now; blocked threads catch up when woken.
+
+    Every ready thread is taken off the run queue in scheduling order before
+    any is put back, so threads that land on the same level keep their
+    relative order.  They are put back one at a time, letting interrupts in
+    between; the interrupt handlers that may run meanwhile only ever add
+    threads to the run queue. */
+static void decay_recent_cpu(void) {
+    struct list batch;
+    struct thread *t;
+    fixedpt twice_load = fixedpt_mul(int_to_fixedpt(2), load_avg);
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    decay_coeffs[decays_done % DECAY_HISTORY] =
+        fixedpt_div(twice_load, fixedpt_add(twice_load, int_to_fixedpt(1)));
+    decays_done++;
+
+    t = thread_current();
+    catch_up_recent_cpu(t);
+    recalculate_priority(t);
+
+    list_init(&batch);
+    while ((t = ready_queue_pop()) != NULL)
+        list_push_back(&batch, &t->elem);
+    while (!list_empty(&batch)) {
+        t = list_entry(list_pop_front(&batch), struct thread, elem);
+        catch_up_recent_cpu(t);
+        recalculate_priority(t);
+        ready_queue_push(t);
+
+        intr_enable();
+        intr_disable();
     }
-    ASSERT (thread_get_priority() >= PRI_MIN 
-        && thread_get_priority() <= PRI_MAX);
-    ASSERT (t->priority >= PRI_MIN && t->priority <= PRI_MAX);
-    ASSERT (t->niceness >= NICE_MIN && t->niceness <= NICE_MAX);
 }
 
 static void recalculate_load_avg() {
@@ -252,9 +744,9 @@ static void recalculate_load_avg() {
     ASSERT (thread_get_nice() >= NICE_MIN && thread_get_nice() <= NICE_MAX);
     fixedpt ready;
     if (strcmp(thread_current()->name, "idle") == 0) {
-        ready = int_to_fixedpt(list_size(&ready_list));
+        ready = int_to_fixedpt(ready_queue_count());
     } else {
-        ready = int_to_fixedpt(list_size(&ready_list) + 1);
+        ready = int_to_fixedpt(ready_queue_count() + 1);
     }
     fixedpt fp59 = int_to_fixedpt(59);
     fixedpt fp60 = int_to_fixedpt(60);
@@ -267,18 +759,25 @@ static void recalculate_load_avg() {
         && thread_get_priority() <= PRI_MAX);
 }
 
+/*! Once a second under the MLFQS, decays recent_cpu and updates load_avg.
+    This visits every ready thread, so thread_tick() defers it to the
+    scheduler softirq rather than doing it in the timer interrupt. */
+static void mlfqs_softirq(void) {
+    enum intr_level old_level = intr_disable();
+
+    decay_recent_cpu();
+    recalculate_load_avg();
+    if (max_ready_priority() > thread_get_priority())
+        intr_yield_on_return();
+
+    intr_set_level(old_level);
+}
+
 /*! Called by the timer interrupt handler at each timer tick.
     Thus, this function runs in an external interrupt context. */
 void thread_tick(void) {
     struct thread *t = thread_current();
-    struct thread *iter_thread;
-    struct list_elem *e;
-    struct thread_sleeping *current_sleeper;
     int64_t current_ticks;
-    int max_sleeper_pri = -1;
-    int max_pri = -1;
-
-
 
     ASSERT(intr_context());
 
@@ -292,60 +791,58 @@ void thread_tick(void) {
     else
         kernel_ticks++;
 
-    current_ticks = timer_ticks();
+    if (thread_cfs && t != idle_thread) {
+        t->vruntime += (int64_t) CFS_TICK_VRUNTIME * CFS_NICE0_WEIGHT /
+                       cfs_weight(t);
+        cfs_update_min_vruntime();
+    }
 
-	if (thread_mlfqs) {
-        
-        /* Recalculate priority for all threads every fourth clock tick. */
-        if (current_ticks % 4 == 0) {
-            for (e = list_begin(&all_list); e != list_end(&all_list);
-                 e = list_next(e)) {
-                iter_thread = list_entry(e, struct thread, allelem);
-                recalculate_priority(iter_thread);
-                if (iter_thread->priority > max_pri)
-                    max_pri = iter_thread->priority;
-            }
-
-            /* Recalculate recent_cpu and load_avg every second */
-            if (current_ticks % TIMER_FREQ == 0) {
-                /* This should occur ever TIMER_FREQ ticks (every second). */
-                /* Iterate through all threads (running, ready or blocked) and 
-                   recalculate recent_cpu. */
-                for (e = list_begin(&all_list); e != list_end(&all_list);
-                     e = list_next(e)) {
-                    iter_thread = list_entry(e, struct thread, allelem);
-                    recalculate_recent_cpu(iter_thread);
-                }
-
-                /* Update load_avg. */  
-                recalculate_load_avg();
-            }
+    /* Charge the tick to the thread's CPU bandwidth group, preempting the
+       thread if that used up the group's quota. */
+    if (t->cpugroup != NULL && cpugroup_charge(t->cpugroup))
+        intr_yield_on_return();
+
+    /* Charge an EDF thread's budget, throttling it into its normal class
+       once the budget is spent. */
+    if (t->edf && !t->edf_throttled) {
+        if (!t->edf_missed && timer_ticks() >= t->edf_abs_deadline) {
+            t->edf_missed = true;
+            t->stats.deadline_misses++;
+            schedstat_totals.deadline_misses++;
+        }
+        if (--t->edf_budget <= 0) {
+            t->edf_throttled = true;
+            intr_yield_on_return();
         }
+    }
 
+    current_ticks = timer_ticks();
+
+    if (thread_mlfqs) {
+        /* Only the running thread's recent_cpu changes from tick to tick, so
+           it is the only thread whose priority needs recomputing every
+           fourth tick.  Ready threads are brought up to date by the
+           per-second decay and blocked threads when they are woken. */
         if (t != idle_thread) {
             /* Increment recent_cpu with fixed point arithmetic. */
             t->recent_cpu = fixedpt_add(t->recent_cpu, int_to_fixedpt(1));
         }
-    }
 
-    /* Unblock all sleeping threads that need to be woken up. */
-    e = list_begin(&sleep_list);
-    while (e != list_end(&sleep_list)) {
-        current_sleeper = list_entry(e, struct thread_sleeping, elem);
-        if (current_sleeper->end_ticks > current_ticks) {
-            break;
+        /* Recalculate recent_cpu and load_avg every second */
+        if (current_ticks % TIMER_FREQ == 0)
+            softirq_raise(SOFTIRQ_SCHED);
+        else if (current_ticks % 4 == 0) {
+            recalculate_priority(t);
         }
-        if (effective_priority(current_sleeper->t) > max_sleeper_pri)
-            max_sleeper_pri = max(effective_priority(current_sleeper->t), max_pri);
-        list_remove(&current_sleeper->elem);    
-        thread_unblock(current_sleeper->t);
-
-        e = list_next(e);
     }
-    
-    /* Enforce preemption. */
-    if (++thread_ticks >= TIME_SLICE || 
-        max_sleeper_pri >= thread_get_priority())
+
+    /* Enforce preemption.  An EDF thread with budget left is not
+       time-sliced; it runs until it blocks, runs out of budget or a thread
+       with an earlier deadline becomes ready. */
+    if (t->edf && !t->edf_throttled)
+        return;
+    if (++thread_ticks >= (thread_cfs ? cfs_slice(t) : TIME_SLICE) ||
+        (thread_mlfqs && max_ready_priority() > thread_get_priority()))
         intr_yield_on_return();
 
 }
@@ -356,6 +853,112 @@ void thread_print_stats(void) {
            idle_ticks, kernel_ticks, user_ticks);
 }
 
+/*! Returns the wakeup latency histogram bucket for a wait of US
+    microseconds. */
+static int schedstat_bucket(int64_t us) {
+    int bucket = 0;
+
+    while (us > 0 && bucket < SCHEDSTAT_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/*! Updates the scheduler statistics for a switch from PREV, which may be
+    NULL if there was no switch, to CUR.  Interrupts must be off. */
+static void schedstat_account(struct thread *prev, struct thread *cur) {
+    int64_t now, ran, waited;
+    int bucket;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    now = timer_now_ns();
+    if (prev != NULL) {
+        ran = now - prev->running_since;
+        prev->stats.run_ns += ran;
+        schedstat_totals.run_ns += ran;
+        cur->running_since = now;
+
+        if (prev->status == THREAD_READY) {
+            prev->stats.involuntary_switches++;
+            schedstat_totals.involuntary_switches++;
+        } else {
+            prev->stats.voluntary_switches++;
+            schedstat_totals.voluntary_switches++;
+        }
+    }
+
+    if (cur->ready_since < 0)
+        return;
+    waited = now - cur->ready_since;
+    cur->ready_since = -1;
+    cur->stats.wait_ns += waited;
+    schedstat_totals.wait_ns += waited;
+    if (cur->woken) {
+        bucket = schedstat_bucket(waited / 1000);
+        cur->stats.latency_hist[bucket]++;
+        schedstat_totals.latency_hist[bucket]++;
+    }
+}
+
+/*! Prints a wakeup latency histogram. */
+static void print_latency_hist(const unsigned hist[SCHEDSTAT_BUCKETS]) {
+    int i;
+
+    printf("  wakeup latency (us):");
+    for (i = 0; i < SCHEDSTAT_BUCKETS; i++) {
+        if (i == 0)
+            printf(" 0: %u", hist[i]);
+        else if (i == SCHEDSTAT_BUCKETS - 1)
+            printf(", %d+: %u", 1 << (i - 1), hist[i]);
+        else if (i == 1)
+            printf(", 1: %u", hist[i]);
+        else
+            printf(", %d-%d: %u", 1 << (i - 1), (1 << i) - 1, hist[i]);
+    }
+    printf("\n");
+}
+
+/*! Prints one thread's scheduler statistics.  Used by thread_foreach(). */
+static void print_thread_schedstat(struct thread *t, void *aux UNUSED) {
+    printf("  %3d %-16s %8u %8u %10lld %10lld %6u\n", t->tid, t->name,
+           t->stats.voluntary_switches, t->stats.involuntary_switches,
+           t->stats.run_ns / 1000, t->stats.wait_ns / 1000,
+           t->stats.deadline_misses);
+}
+
+/*! Prints scheduler statistics: totals over every thread that has run, a
+    wakeup latency histogram, and counters for each live thread. */
+void thread_print_schedstat(void) {
+    enum intr_level old_level = intr_disable();
+
+    printf("Schedstat: %u voluntary, %u involuntary switches, "
+           "%lld us run, %lld us waiting, %u deadline misses\n",
+           schedstat_totals.voluntary_switches,
+           schedstat_totals.involuntary_switches,
+           schedstat_totals.run_ns / 1000, schedstat_totals.wait_ns / 1000,
+           schedstat_totals.deadline_misses);
+    print_latency_hist(schedstat_totals.latency_hist);
+    printf("  tid name                  vol    invol    run(us)   wait(us)"
+           "   miss\n");
+    thread_foreach(print_thread_schedstat, NULL);
+    intr_set_level(old_level);
+}
+
+/*! Copies the scheduler statistics of the thread with TID into STATS.
+    Returns false if there is no such thread. */
+bool thread_get_schedstat(tid_t tid, struct schedstat *stats) {
+    struct thread *t;
+
+    rcu_read_lock();
+    t = thread_lookup(tid);
+    if (t != NULL)
+        *stats = t->stats;
+    rcu_read_unlock();
+    return t != NULL;
+}
+
 /*! Creates a new kernel thread named NAME with the given initial PRIORITY,
     which executes FUNCTION passing AUX as the argument, and adds it to the
     ready queue.  Returns the thread identifier for the new thread, or
@@ -391,12 +994,15 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
     /* Initialize thread. */
     init_thread(t, name, priority);
     tid = t->tid = allocate_tid();
+    tid_table_insert(t);
+    cpugroup_join(t, thread_current()->cpugroup);
     
 
     /* Initialize the supplemental page table. */
     /* TODO: Are there any issues initializing the list here? */
 #ifdef VM
     hash_init(&t->spt, &spt_hash_func, &spt_less, NULL);
+    lock_init(&t->spt_lock);
 #endif
 
 #ifdef USERPROG
@@ -413,6 +1019,9 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
     t->process_details->num_files_open = 2;
     
     t->process_details->parent_id = thread_current()->tid;
+    t->process_details->leader = t;
+    t->process_details->num_threads = 1;
+    sema_init(&t->process_details->threads_gone, 0);
 
     t->child_loaded_sema = palloc_get_page(PAL_ZERO);
     if (t->child_loaded_sema == NULL) {
@@ -461,13 +1070,10 @@ tid_t thread_create(const char *name, int priority, thread_func *function,
     t->exit_status = 0;
 #endif
     
-    /* If this thread's priority is higher than or equal than the 
-     * running thread's priority, yield the processor
-     */
-    if (effective_priority(t) >= thread_get_priority()) {
-        /* Yield current thread, as the created thread has higher priority */
+    /* Yield the processor if the new thread should run before us, by the
+       rules of whichever scheduler is active. */
+    if (thread_should_preempt(t))
         thread_yield();
-    }
 
     return tid;
 }
@@ -486,25 +1092,6 @@ void thread_block(void) {
     schedule();
 }
 
-/*! The ready LESS function, as required by the list_insert_ordered function,
-    since the ready_list will be an ordered list. Used for comparing if one
-    thread struct is LESS than the other, by comparing priority values. */
-bool ready_less(const struct list_elem *elem1, const struct list_elem *elem2,
-                void *aux) {
-    struct thread *t1, *t2;
-    t1 = list_entry(elem1, struct thread, elem);
-    t2 = list_entry(elem2, struct thread, elem);
-
-    ASSERT((t1->priority >= PRI_MIN) && (t1->priority <= PRI_MAX));
-    ASSERT((t2->priority >= PRI_MIN) && (t2->priority <= PRI_MAX));
-
-    /* We compare in this way so that if t1's priority is greater than t2's,
-     * we will ensure that t1 will be placed before (closer to the HEAD of 
-     * the ready queue) than t2.
-     */
-    return effective_priority(t1) >=  effective_priority(t2);
-}
-
 /*! Transitions a blocked thread T to the ready-to-run state.  This is an
     error if T is not blocked.  (Use thread_yield() to make the running
     thread ready.)
@@ -520,14 +1107,28 @@ void thread_unblock(struct thread *t) {
     old_level = intr_disable();
     ASSERT(t->status == THREAD_BLOCKED);
 
-    list_insert_ordered(&ready_list, &t->elem, &ready_less, NULL);
+    /* A blocked thread's MLFQS state is not maintained while it sleeps;
+       bring it up to date before it competes for the CPU again. */
+    if (thread_mlfqs) {
+        catch_up_recent_cpu(t);
+        recalculate_priority(t);
+    }
+
+    /* Under CFS, a thread that slept keeps its vruntime, so that it runs
+       soon after waking, but no more than half a period's credit, so that
+       sleeping does not let it monopolize the CPU afterward. */
+    if (thread_cfs) {
+        int64_t floor = ready_queue.min_vruntime -
+                        CFS_LATENCY * CFS_TICK_VRUNTIME / 2;
+        if (t->vruntime < floor)
+            t->vruntime = floor;
+    }
 
+    ready_queue_push(t);
     t->status = THREAD_READY;
+    t->ready_since = timer_now_ns();
+    t->woken = true;
 
-    /* Make sure the list is ordered */
-    if (!get_thread_mlfqs()) {
-        ASSERT(list_sorted(&ready_list, &ready_less, NULL));
-    }
     intr_set_level(old_level);
 }
 
@@ -567,18 +1168,33 @@ void thread_exit(void) {
     struct thread_dead *td;
 #endif
 
+    /* An exiting reader would hold back freeing forever. */
+    ASSERT(thread_current()->rcu_nesting == 0);
+
+    /* Leaving may free the group, so do it while interrupts are on. */
+    cpugroup_leave(thread_current());
+
     /* Remove thread from all threads list, set our status to dying,
        and schedule another process.  That process will destroy us
        when it calls thread_schedule_tail(). */
     intr_disable();
     list_remove(&thread_current()->allelem);
+    list_remove(&thread_current()->tidelem);
+    edf_leave(thread_current());
 #ifdef USERPROG
 
     /*
      * Note that this makes sense only when we're talking about
      * kernel threads that correspond to user processes
      */
-    if (thread_current()->process_details != NULL) {
+    if (thread_current()->process_details != NULL &&
+        thread_current()->process_details->leader != thread_current()) {
+        /* A user thread: the process lives on in its leader. */
+        process_thread_exit();
+        palloc_free_page(thread_current()->waiter_sema);
+        palloc_free_page(thread_current()->child_loaded_sema);
+    }
+    else if (thread_current()->process_details != NULL) {
         file_close(thread_current()->process_details->exec_file);
         
         printf("%s: exit(%d)\n", thread_current()->name, thread_current()->exit_status);
@@ -619,39 +1235,19 @@ void thread_exit(void) {
     may be scheduled again immediately at the scheduler's whim. */
 void thread_yield(void) {
     struct thread *cur = thread_current();
-    struct thread *cur_ready;
-    struct list_elem *cur_ready_elem;
     enum intr_level old_level;
-    unsigned i = 0;
 
     ASSERT(!intr_context());
 
     old_level = intr_disable();
 
+    /* The run queue levels are FIFO, so this places the current thread
+       behind any other threads of the same priority, per round-robin
+       rules. */
     if (cur != idle_thread) {
-        /* If there are other threads with the same priority as the thread 
-           we are currently yielding, then place the current running thread 
-           behind those threads, per round-robin rules. */
-        if (!list_empty(&ready_list)) {
-            cur_ready_elem = list_begin(&ready_list);
-            cur_ready = list_entry(cur_ready_elem, struct thread, elem);
-            if (effective_priority(cur_ready) == effective_priority(cur)) {
-                i = 0;
-                while (effective_priority(cur_ready) == effective_priority(cur)
-                        &&  i < list_size(&ready_list)) {
-                    i++;
-                    cur_ready_elem = list_next(cur_ready_elem);
-                    cur_ready = list_entry(cur_ready_elem, struct thread, elem);
-                }
-                list_insert(cur_ready_elem, &cur->elem);
-            }
-            else {
-                list_insert_ordered(&ready_list, &cur->elem, &ready_less, NULL);
-            }
-        }
-        else {
-            list_insert_ordered(&ready_list, &cur->elem, &ready_less, NULL);
-        }
+        ready_queue_push(cur);
+        cur->ready_since = timer_now_ns();
+        cur->woken = false;
     }
 
     cur->status = THREAD_READY;
@@ -659,77 +1255,102 @@ void thread_yield(void) {
     intr_set_level(old_level);
 }
 
-/*! LESS function provided to list_insert_ordered for the sleep_list. */
-bool thread_sleep_less(const struct list_elem *elem1, 
-                       const struct list_elem *elem2, void *aux) {
-    /* The aux pointer is required, however we don't have need any auxiliary
-     * data to perform our LESS comparison.
-     */
-    struct thread_sleeping *st1, *st2;
-    st1 = list_entry(elem1, struct thread_sleeping, elem);
-    st2 = list_entry(elem2, struct thread_sleeping, elem);
-
-    /* Return true if st1->end_ticks <= st2->end_ticks. */
-    return (st1->end_ticks <= st2->end_ticks);
-}
-
-/* Puts a thread to sleep until end_ticks */
+/*! Puts the current thread to sleep until timer tick END_TICKS.  The wakeup
+    is a timer event embedded in the thread, so this never allocates. */
 void thread_sleep(int64_t end_ticks) {
     struct thread *t = thread_current();
-    struct thread_sleeping *st = palloc_get_page(PAL_ZERO);
     enum intr_level old_level;
 
     /* This shouldn't be called on an interrupt context */
     ASSERT(!intr_context());
 
-    /* Disable interrupts, as we shouldn't be interrupted here.
-     * We're dealing with running/blocked queues, hence we are 
-     * modifying global state.
-     */
+    /* Disable interrupts, so the wakeup cannot fire before we block. */
     old_level = intr_disable();
-
-    if (st == NULL) {
-        thread_yield();
-    }
-    else {
-        st->t = t;
-        st->end_ticks = end_ticks;
-        
-        /* Pass in NULL for auxiliary data pointer AUX. */
-        list_insert_ordered(&sleep_list, &st->elem, &thread_sleep_less, NULL);
-
-        /* Make sure the list is ordered */
-        if (!get_thread_mlfqs()) {
-            ASSERT(list_sorted(&ready_list, &ready_less, NULL));
-        }
-
-    }
-    
-    /* Take this thread off the ready list */
+    timer_add(&t->sleep_event, end_ticks, thread_wake, t);
     thread_block();
     intr_set_level(old_level);
 }
 
+/*! Timer callback that wakes sleeping thread T_, preempting the running
+    thread if T_ should run instead. */
+static void thread_wake(void *t_) {
+    struct thread *t = t_;
 
-
+    thread_unblock(t);
+    if (thread_should_preempt(t))
+        intr_yield_on_return();
+}
 
 /*! Invoke function 'func' on all threads, passing along 'aux'.
-    This function must be called with interrupts off. */
+    Interrupts need not be off: if they are on, the walk runs inside
+    rcu_read_lock(), so threads that exit meanwhile stay readable, though
+    FUNC may see them in THREAD_DYING state. */
 void thread_foreach(thread_action_func *func, void *aux) {
     struct list_elem *e;
+    bool reader = intr_get_level() == INTR_ON;
 
-    ASSERT(intr_get_level() == INTR_OFF);
-
+    if (reader)
+        rcu_read_lock();
     for (e = list_begin(&all_list); e != list_end(&all_list);
          e = list_next(e)) {
         struct thread *t = list_entry(e, struct thread, allelem);
         func(t, aux);
     }
+    if (reader)
+        rcu_read_unlock();
+}
+
+/*! Returns the live thread with the given TID, or NULL if there is none.
+    Must be called with interrupts off or inside rcu_read_lock(); in the
+    latter case the returned thread may exit once the read lock is dropped,
+    so the caller needs some other guarantee to keep using it. */
+struct thread *thread_lookup(tid_t tid) {
+    struct list *bucket = &tid_table[(unsigned) tid % TID_TABLE_SIZE];
+    struct list_elem *e;
+
+    ASSERT(intr_get_level() == INTR_OFF || thread_current()->rcu_nesting > 0);
+
+    for (e = list_begin(bucket); e != list_end(bucket); e = list_next(e)) {
+        struct thread *t = list_entry(e, struct thread, tidelem);
+        if (t->tid == tid && t->status != THREAD_DYING)
+            return t;
+    }
+    return NULL;
+}
+
+/*! Enters a read-side section.  Until the matching rcu_read_unlock(), no
+    thread reachable from all_list or the tid table is freed, so they can be
+    walked without disabling interrupts.  Sections nest and may block, but a
+    long one holds back the freeing of every thread that exits meanwhile. */
+void rcu_read_lock(void) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    if (cur->rcu_nesting++ > 0)
+        return;
+
+    old_level = intr_disable();
+    cur->rcu_epoch = rcu_epoch;
+    rcu_readers[rcu_epoch % 2]++;
+    intr_set_level(old_level);
+}
+
+/*! Leaves a read-side section entered with rcu_read_lock(). */
+void rcu_read_unlock(void) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(cur->rcu_nesting > 0);
+    if (--cur->rcu_nesting > 0)
+        return;
+
+    old_level = intr_disable();
+    rcu_readers[cur->rcu_epoch % 2]--;
+    intr_set_level(old_level);
 }
 
 /*! Sets the current thread's priority to NEW_PRIORITY. */
 void thread_set_priority(int new_priority) {
-    struct thread *max;
     enum intr_level old_level;
     
     ASSERT((new_priority >= PRI_MIN) && (new_priority <= PRI_MAX));
@@ -737,16 +1358,9 @@ void thread_set_priority(int new_priority) {
 
     thread_current()->priority = new_priority;
 
-    /* Make sure the list is ordered */
-    if (!get_thread_mlfqs()) {
-        ASSERT(list_sorted(&ready_list, &ready_less, NULL));
-    }
-
-    /* Max priority thread */
-    max = list_entry(list_begin(&ready_list), struct thread, elem);
-
-    /* If the max thread is not the current thread */
-    if (max != thread_current()) {
+    /* Yield if a ready thread should now run before (or, round-robin, in
+       turn with) the current thread. */
+    if (ready_queue_max() >= thread_get_priority()) {
         thread_yield();
     }
 
@@ -765,25 +1379,19 @@ int thread_get_priority(void) {
 /*! Sets the current thread's nice value to NICE. */
 void thread_set_nice(int nice UNUSED) {
     struct thread *cur = thread_current();
-    struct thread *next_ready;
-    struct list_elem *next_ready_elem;
     enum intr_level old_level;
 
+    old_level = intr_disable();
+    catch_up_recent_cpu(cur);
     cur->niceness = nice;
     ASSERT (thread_get_nice() >= NICE_MIN && thread_get_nice() <= NICE_MAX);
-    old_level = intr_disable();
-
 
     recalculate_priority(cur);
-    if (list_size(&ready_list) > 0) {
-        next_ready_elem = list_begin(&ready_list);
-        next_ready = list_entry(next_ready_elem, struct thread, elem);
-        
-        /* If the current thread is no longer the highest priority thread,
-           then yield. */
-        if (next_ready->priority > cur->priority) {
-            thread_yield();
-        }
+
+    /* If the current thread is no longer the highest priority thread,
+       then yield. */
+    if (ready_queue_max() > cur->priority) {
+        thread_yield();
     }
     intr_set_level(old_level);
 }
@@ -801,8 +1409,14 @@ int thread_get_load_avg(void) {
 
 /*! Returns 100 times the current thread's recent_cpu value. */
 int thread_get_recent_cpu(void) {
-    return fixedpt_to_int_nearest(fixedpt_mul(int_to_fixedpt(100),
-           thread_current()->recent_cpu));
+    enum intr_level old_level = intr_disable();
+    int recent_cpu;
+
+    catch_up_recent_cpu(thread_current());
+    recent_cpu = fixedpt_to_int_nearest(fixedpt_mul(int_to_fixedpt(100),
+                 thread_current()->recent_cpu));
+    intr_set_level(old_level);
+    return recent_cpu;
 }
 
 /*! Idle thread.  Executes when no other thread is ready to run.
@@ -823,6 +1437,9 @@ static void idle(void *idle_started_ UNUSED) {
         intr_disable();
         thread_block();
 
+        /* In tickless mode, don't take timer interrupts we don't need. */
+        timer_enter_idle();
+
         /* Re-enable interrupts and wait for the next one.
 
            The `sti' instruction disables interrupts until the completion of
@@ -832,7 +1449,9 @@ static void idle(void *idle_started_ UNUSED) {
            next one to occur, wasting as much as one clock tick worth of time.
 
            See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
-           7.11.1 "HLT Instruction". */
+           7.11.1 "HLT Instruction".  Since this bypasses intr_enable(),
+           close the interrupts-off section here. */
+        irqsoff_end(idle);
         asm volatile ("sti; hlt" : : : "memory");
     }
 }
@@ -874,7 +1493,9 @@ static void init_thread(struct thread *t, const char *name, int priority) {
     memset(t, 0, sizeof *t);
     t->status = THREAD_BLOCKED;
     strlcpy(t->name, name, sizeof t->name);
-    t->donee = NULL;
+    list_init(&t->held_locks);
+    t->waiting_lock = NULL;
+    t->ready_since = -1;
     t->stack = (uint8_t *) t + PGSIZE;
     t->priority = priority;
     t->donation_priority = -1;
@@ -884,6 +1505,7 @@ static void init_thread(struct thread *t, const char *name, int priority) {
         /* If we're in the first thread, set recent_cpu to 0, otherwise set to
            current thread's recent_cpu. */
         t->recent_cpu = int_to_fixedpt(0);
+        t->decays_seen = decays_done;
         if (strcmp(name, "main") == 0 || strcmp(t->name, "idle") == 0) {
             t->niceness = 0;
         }
@@ -893,6 +1515,13 @@ static void init_thread(struct thread *t, const char *name, int priority) {
         }
     }
 
+    /* A new CFS thread starts level with the threads already here. */
+    if (thread_cfs) {
+        t->vruntime = ready_queue.min_vruntime;
+        if (strcmp(name, "main") != 0)
+            t->niceness = thread_get_nice();
+    }
+
     t->magic = THREAD_MAGIC;
 
 
@@ -901,6 +1530,39 @@ static void init_thread(struct thread *t, const char *name, int priority) {
     intr_set_level(old_level);
 }
 
+/*! Adds T, whose tid has just been allocated, to the tid table. */
+static void tid_table_insert(struct thread *t) {
+    enum intr_level old_level;
+
+    old_level = intr_disable();
+    list_push_back(&tid_table[(unsigned) t->tid % TID_TABLE_SIZE],
+                   &t->tidelem);
+    intr_set_level(old_level);
+}
+
+/*! Retires the dead thread PREV, freeing it once no read-side section that
+    could have found it is left, and frees whatever earlier retirements have
+    become safe.  PREV's elem is free for reuse: a dying thread is on no
+    run queue or wait list. */
+static void rcu_retire(struct thread *prev) {
+    struct list *freeable;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (prev != NULL)
+        list_push_back(&rcu_retired[rcu_epoch % 3], &prev->elem);
+
+    /* Readers of the previous epoch share a counter with the next one. */
+    if (rcu_readers[(rcu_epoch + 1) % 2] != 0)
+        return;
+
+    rcu_epoch++;
+    freeable = &rcu_retired[(rcu_epoch + 1) % 3];
+    while (!list_empty(freeable))
+        palloc_free_page(list_entry(list_pop_front(freeable),
+                                    struct thread, elem));
+}
+
 /*! Allocates a SIZE-byte frame at the top of thread T's stack and
     returns a pointer to the frame's base. */
 static void * alloc_frame(struct thread *t, size_t size) {
@@ -917,38 +1579,22 @@ static void * alloc_frame(struct thread *t, size_t size) {
     thread can continue running, then it will be in the run queue.)  If the
     run queue is empty, return idle_thread. */
 static struct thread * next_thread_to_run(void) {
-    struct list_elem *e;
-    int max_pri = -1;
-    struct thread *max_thread, *iter;
+    struct thread *next;
 
     ASSERT(intr_get_level() == INTR_OFF);
 
-    /* Only assert sorted for NON mlfqs, other approach is manual in schedule */
-    if (!get_thread_mlfqs()) {
-        ASSERT(list_sorted(&ready_list, &ready_less, NULL));
-    }
-
-    if (list_empty(&ready_list)) {
-        return idle_thread;
-    } 
-    if (!thread_mlfqs) {    
-        return list_entry(list_pop_front(&ready_list), struct thread, elem);
-    }
-    else {
-        /* Loop through all threads and find the one that has the max
-         * priority. Return that one to get scheduled.
-         */
-        for (e = list_begin(&ready_list); e != list_end(&ready_list); 
-             e = list_next(e)) {
-            iter = list_entry(e, struct thread, elem);
-            if (iter->priority > max_pri) {
-                max_pri = iter->priority;
-                max_thread = iter;
-            } 
-        }
-        list_remove(&max_thread->elem);
-        return max_thread;
+    /* The run queue hands out threads in scheduling order, so the next
+       thread is simply the first one it yields whose CPU bandwidth group is
+       not throttled; the others are parked until their group's next
+       period. */
+    for (;;) {
+        next = ready_queue_pop();
+        if (next == NULL || next->cpugroup == NULL ||
+            !next->cpugroup->throttled)
+            break;
+        cpugroup_park(next);
     }
+    return next != NULL ? next : idle_thread;
 }
 
 /*! Completes a thread switch by activating the new thread's page tables, and,
@@ -972,6 +1618,9 @@ void thread_schedule_tail(struct thread *prev) {
 
     /* Mark us as running. */
     cur->status = THREAD_RUNNING;
+    schedstat_account(prev, cur);
+    if (prev != NULL)
+        TRACE(TRACE_SCHEDULE, prev->tid, prev->status);
 
     /* Start new time slice. */
     thread_ticks = 0;
@@ -984,12 +1633,15 @@ void thread_schedule_tail(struct thread *prev) {
     /* If the thread we switched from is dying, destroy its struct thread.
        This must happen late so that thread_exit() doesn't pull out the rug
        under itself.  (We don't free initial_thread because its memory was
-       not obtained via palloc().) */
+       not obtained via palloc().)  Readers may still be looking at it, so
+       the page is only retired here; see rcu_retire(). */
     if (prev != NULL && prev->status == THREAD_DYING &&
         prev != initial_thread) {
         ASSERT(prev != cur);
-        palloc_free_page(prev);
+        rcu_retire(prev);
     }
+    else
+        rcu_retire(NULL);
 }
 
 /*! Schedules a new process.  At entry, interrupts must be off and the running
@@ -1007,39 +1659,11 @@ static void schedule(void) {
     ASSERT(cur->status != THREAD_RUNNING);
     ASSERT(is_thread(next));
 
-    /* Only assert sorted for NON mlfqs, other approach is manual in schedule */
-    if (!get_thread_mlfqs()) {
-        ASSERT(list_sorted(&ready_list, &ready_less, NULL));
-    }
-
     if (cur != next)
         prev = switch_threads(cur, next);
     thread_schedule_tail(prev);
 }
 
-/* Donate current thread's priority to donee */
-void donate_priority(struct thread *donee) {
-    enum intr_level old_level;
-
-    /* Check if donee is a valid thread */
-    ASSERT(is_thread(donee));
-    
-    old_level = intr_disable();
-
-    /* Set donees priority to current thread's priority */
-    donee->donation_priority = thread_get_priority();
-
-    list_sort(&ready_list, &ready_less, NULL);
-
-    /* Make sure the list is ordered */
-    if (!get_thread_mlfqs()) {
-        ASSERT(list_sorted(&ready_list, &ready_less, NULL));
-    }
-
-    intr_set_level(old_level);
-}
-    
-
 /*! Returns a tid to use for a new thread. */
 static tid_t allocate_tid(void) {
     static tid_t next_tid = 1;
@@ -9,6 +9,8 @@
 #include <debug.h>
 #include <hash.h>
 #include <list.h>
+#include <rbtree.h>
+#include <schedstat.h>
 #include <stdint.h>
 #include "devices/timer.h"
 #include "threads/fixed-point.h"
@@ -39,6 +41,9 @@ typedef int pid_t;
 /*! A process can have a max of 128 open files */
 #define MAX_OPEN_FILES 128
 
+/*! A process can have a max of 16 user threads besides its leader */
+#define MAX_USER_THREADS 16
+
 
 
 /* Definitions for types representing memory mapped files */
@@ -49,8 +54,22 @@ struct mmap_t {
 };
 
 
+/*! A user thread of a process, started with the uthread_spawn system
+    call.  The slot stays in use until the thread has been joined, or, if
+    it has been detached, until it exits. */
+struct uthread {
+    bool in_use;                        /*!< Slot allocated? */
+    bool joining;                       /*!< Someone in uthread_join()? */
+    bool detached;                      /*!< No one may join it? */
+    bool exited;                        /*!< Thread has exited? */
+    tid_t tid;                          /*!< The thread's tid. */
+    int status;                         /*!< Exit status, once exited. */
+    struct semaphore done;              /*!< Upped when the thread exits. */
+};
+
 /*! Process struct used by the kernel to keep track of process specific
-    information as opposed to thread specific information. */
+    information as opposed to thread specific information.  User threads
+    share their leader's process struct and page directory. */
 
 struct process {
     tid_t parent_id;
@@ -64,6 +83,15 @@ struct process {
     int num_mapids_open;
     bool open_mapids[MAX_OPEN_FILES];
     struct mmap_t open_mmaps[MAX_OPEN_FILES];
+
+    /* The thread that loaded the process.  It owns the page directory and
+       supplemental page table and outlives every other thread. */
+    struct thread *leader;
+    int num_threads;                    /* Live threads, the leader too. */
+    bool exiting;                       /* Process is going away? */
+    int exit_status;                    /* Status if a thread killed it. */
+    struct semaphore threads_gone;      /* Upped as each user thread exits. */
+    struct uthread threads[MAX_USER_THREADS];
 };
 
 /*! A kernel thread or user process.
@@ -138,13 +166,62 @@ struct thread {
     int donation_priority;              /*!< Donation priority (-1 if N/A). */
     int niceness;           /*!< Between -20 and 20. */
     fixedpt recent_cpu;         /*!< CPU usage recently. */
+    int ready_pri;                      /*!< Ready queue level, if ready. */
+    struct rb_node cfs_node;            /*!< CFS run queue tree node. */
+    int64_t vruntime;                   /*!< CFS weighted run time. */
+    struct schedstat stats;             /*!< Scheduler statistics. */
+    int64_t ready_since;                /*!< Time this thread became ready,
+                                             in timer_now_ns() nanoseconds,
+                                             -1 if not waiting to run. */
+    int64_t running_since;              /*!< Time this thread last started
+                                             running, likewise. */
+    bool woken;                         /*!< Became ready by being woken,
+                                             not by yielding? */
+    unsigned decays_seen;               /*!< recent_cpu decays applied. */
     struct list_elem allelem;           /*!< List element for all threads list. */
+    struct list_elem tidelem;           /*!< List element for tid table. */
+    int rcu_nesting;                    /*!< rcu_read_lock() depth. */
+    unsigned rcu_epoch;                 /*!< Epoch of outermost read lock. */
     /**@}*/
 
 
-    /* The thread this thread donates to. NULL if this thread doesn't donate
-       to any thread. */
-    struct thread *donee;
+    /* Locks held by this thread.  Its donation_priority is the highest
+       priority donated through any of them. */
+    struct list held_locks;
+
+    /* The lock this thread is blocked acquiring, NULL if none.  Its holder
+       is the thread this thread donates to. */
+    struct lock *waiting_lock;
+
+    /* The semaphore this thread is blocked in sema_down() on, NULL if none,
+       and its entry in a condition variable's wait queue, NULL if none.
+       Owned by synch.c, which keys the wait queues on priority and moves
+       the thread within them when a donation changes its priority. */
+    struct semaphore *waiting_sema;
+    struct semaphore_elem *cond_waiter;
+    struct rb_node wait_node;
+    int wait_pri;
+
+    /* Timer event that wakes this thread from thread_sleep(). */
+    struct timer_event sleep_event;
+
+    /* Earliest-deadline-first class state; see thread_set_edf().  Times
+       are in timer ticks. */
+    bool edf;                           /*!< In the EDF class? */
+    bool edf_throttled;                 /*!< Used up this period's budget? */
+    bool edf_missed;                    /*!< Miss counted for this job? */
+    bool edf_queued;                    /*!< On an EDF run queue tree? */
+    int64_t edf_runtime;                /*!< Budget per period. */
+    int64_t edf_deadline;               /*!< Relative deadline. */
+    int64_t edf_period;                 /*!< Release period. */
+    int edf_bandwidth;                  /*!< Admitted CPU share, per mille. */
+    int64_t edf_abs_deadline;           /*!< Current job's deadline. */
+    int64_t edf_budget;                 /*!< Runtime left this period. */
+    struct rb_node edf_node;            /*!< EDF run queue tree node. */
+    struct timer_event edf_timer;       /*!< Fires at the next release. */
+
+    /* CPU bandwidth group, or NULL if unlimited; see cpugroup.h. */
+    struct cpugroup *cpugroup;
 
     /*! Shared between thread.c and synch.c. */
     /**@{*/
@@ -180,6 +257,8 @@ struct thread {
 #ifdef VM
     /* Each thread has a supplemental page table (SPT). */
     struct hash spt; 
+    /* Protects SPT, which the threads of a process share. */
+    struct lock spt_lock;
 #endif
 
     /*! Owned by thread.c. */
@@ -188,55 +267,32 @@ struct thread {
     /**@}*/
 };
 
-struct priority_donation_state {
-    /* The lock that the current thread is seeking to unlock so that the 
-     * thread running previously can resume execution.
-     */
-    struct lock *lock_desired;
-    struct thread *donor;
-  struct thread *donee;
-    struct list_elem elem;              /*!< List element. */
-};
-
-/* Keeps track of the state of current running threads under the MLFQ 
-   option. */ 
-struct thread_mlfq_state {
-  struct list *ready_lists;
-  /* Keep track of the highest priority non-empty list in ready_lists, so 
-     that we may access it quickly. */
-  int highest_non_empty_list;
-  /* Keep track of the number of ready threads in all of the ready_lists. */
-  int num_ready;
+/*! Number of distinct priority levels, and so of ready queue levels. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+
+/*! The run queue, used by both the priority and MLFQ schedulers.  There is
+    one FIFO list of ready threads per priority level, plus a bitmap with bit
+    N set iff level N is non-empty, so that enqueueing, dequeueing the highest
+    priority thread and moving a thread between levels are all O(1). */
+struct ready_queue {
+    struct list levels[PRI_CNT];        /*!< One FIFO list per priority. */
+    uint32_t bitmap[(PRI_CNT + 31) / 32]; /*!< Non-empty levels. */
+    int num_ready;                      /*!< Threads on all of the levels. */
+    struct rb_tree cfs_tree;            /*!< CFS: ready threads by vruntime,
+                                             used instead of the levels. */
+    int64_t min_vruntime;               /*!< CFS: never-decreasing floor of
+                                             the ready vruntimes. */
+    int cfs_weight;                     /*!< CFS: sum of ready weights. */
+    struct rb_tree edf_tree;            /*!< Ready EDF threads by deadline,
+                                             which run before all others. */
 };
 
-/*! List of priority donation states, for keeping track of chains of priority 
-    donations (i.e., A donates to B, B donates to C, etc.). When not exploring
-    some chain of priority donations, this linked list is empty. */
-extern struct list pri_donation_list;
-
-
 /* Processes that are dead but haven't been reaped yet */
 #ifdef USERPROG
 extern struct list dead_list;
 #endif
 
 
-/*! A sleeping kernel thread.
-    Stores the thread struct pointer and the time it
-    should be unblocked.
- */
-struct thread_sleeping {
-  /* Thread pointer. */
-  struct thread *t;
-
-  /* End time. Compare to timer_ticks(). */
-  int64_t end_ticks;
-
-  /* List element for sleep list */
-  struct list_elem elem;
-};
-
-
 #ifdef USERPROG
 /*! A waitee kernel thread, i.e. a thread for which its parent is waiting */
 struct thread_dead {
@@ -266,18 +322,22 @@ struct thread_dead {
     Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/*! If true, use the completely fair scheduler, which ignores priorities.
+    Controlled by kernel command-line option "-cfs". */
+extern bool thread_cfs;
+
 void thread_init(void);
 void thread_start(void);
 
 void thread_tick(void);
 void thread_print_stats(void);
+void thread_print_schedstat(void);
+bool thread_get_schedstat(tid_t tid, struct schedstat *stats);
 
 typedef void thread_func(void *aux);
 tid_t thread_create(const char *name, int priority, thread_func *, void *);
 
 void thread_block(void);
-bool ready_less(const struct list_elem *elem1, const struct list_elem *elem2,
-          void *aux);
 void thread_unblock(struct thread *);
 
 struct thread *thread_current (void);
@@ -286,8 +346,6 @@ const char *thread_name(void);
 
 void thread_exit(void) NO_RETURN;
 void thread_yield(void);
-bool thread_sleep_less(const struct list_elem *elem1, 
-             const struct list_elem *elem2, void *aux);
 void thread_sleep(int64_t end_ticks);
 
 /*! Performs some operation on thread t, given auxiliary data AUX. */
@@ -295,19 +353,22 @@ typedef void thread_action_func(struct thread *t, void *aux);
 
 void thread_foreach(thread_action_func *, void *);
 
+struct thread *thread_lookup(tid_t tid);
+void rcu_read_lock(void);
+void rcu_read_unlock(void);
+
 int thread_get_priority(void);
 void thread_set_priority(int);
 
 bool get_thread_mlfqs(void);
+bool thread_should_preempt(struct thread *t);
+bool thread_set_edf(int64_t runtime, int64_t deadline, int64_t period);
 
 /* Schedules the donor of this thread, and sets the priority of the
  * current thread to its original priority
  */
 void schedule_donor(void);
 
-/* Donate current thread's priority to donee */
-void donate_priority(struct thread *donee);
-
 int thread_get_nice(void);
 void thread_set_nice(int);
 int thread_get_recent_cpu(void);
@@ -319,8 +380,11 @@ int max(int a, int b);
 /* Returns the effective priority */
 int effective_priority(struct thread *t);
 
-/* Return max priority of the list */
+/* Return max priority of the ready queue */
 int max_ready_priority(void);
 
+/* Moves T to the ready queue level matching its effective priority */
+void thread_requeue(struct thread *t);
+
 #endif /* threads/thread.h */
 
@@ -0,0 +1,140 @@
+/*! \file trace.c
+ *
+ * Kernel static tracepoints.
+ *
+ * The TRACE() macro, placed at interesting points in the kernel, appends
+ * a fixed-size record to a ring buffer that is allocated at boot when the
+ * "-trace" option is given.  When the buffer fills, the oldest records
+ * are overwritten.  At power off the buffer is written, oldest record
+ * first, to the scratch device as the ustar archive member "trace", from
+ * which `pintos --get-trace' retrieves it; utils/trace2json converts it
+ * to the Chrome trace event format.
+ *
+ * Records are written with interrupts off, so tracepoints may be used in
+ * interrupt handlers and in the scheduler.
+ */
+
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+#ifdef FILESYS
+#include "devices/block.h"
+#include "filesys/fsutil.h"
+#endif
+
+/*! Pages in the ring buffer, including the file header. */
+#define TRACE_PAGES 64
+
+static struct trace_header *header;     /*!< Start of the buffer. */
+static struct trace_record *records;    /*!< Records, after the header. */
+static size_t record_max;               /*!< Capacity of RECORDS. */
+static size_t head;                     /*!< Where the next record goes. */
+static bool wrapped;                    /*!< Has HEAD wrapped around? */
+static uint32_t lost_cnt;               /*!< Records overwritten. */
+
+/*! Record events? */
+bool trace_enabled;
+
+/*! Allocates the ring buffer, if tracing was requested. */
+void trace_init(void) {
+    if (!trace_enabled)
+        return;
+
+    header = palloc_get_multiple(PAL_ASSERT, TRACE_PAGES);
+    records = (struct trace_record *) (header + 1);
+    record_max = (TRACE_PAGES * PGSIZE - sizeof *header) / sizeof *records;
+    printf("Tracing to a buffer of %zu records.\n", record_max);
+}
+
+/*! Appends EVENT, with arguments ARG0 and ARG1, to the ring buffer.
+    Use the TRACE() macro instead of calling this directly. */
+void trace_event(enum trace_event event, uint32_t arg0, uint32_t arg1) {
+    struct trace_record *r;
+    enum intr_level old_level;
+
+    /* Tracepoints reached before trace_init() are dropped. */
+    if (records == NULL)
+        return;
+
+    old_level = intr_disable();
+    if (wrapped)
+        lost_cnt++;
+    r = &records[head];
+    if (++head == record_max) {
+        head = 0;
+        wrapped = true;
+    }
+
+    r->time = timer_now_ns();
+    r->event = event;
+    r->tid = thread_current()->tid;
+    r->arg0 = arg0;
+    r->arg1 = arg1;
+    intr_set_level(old_level);
+}
+
+#ifdef FILESYS
+/*! Reverses the order of the CNT records starting at R. */
+static void reverse_records(struct trace_record *r, size_t cnt) {
+    size_t i;
+
+    for (i = 0; i < cnt / 2; i++) {
+        struct trace_record tmp = r[i];
+        r[i] = r[cnt - i - 1];
+        r[cnt - i - 1] = tmp;
+    }
+}
+
+/*! Stops tracing and writes the trace to the scratch device, after any
+    files written there by the "append" action. */
+void trace_dump(void) {
+    enum intr_level old_level;
+    size_t cnt;
+
+    if (records == NULL)
+        return;
+
+    /* Writing the trace out would otherwise trace itself. */
+    old_level = intr_disable();
+    trace_enabled = false;
+    intr_set_level(old_level);
+
+    if (block_get_role(BLOCK_SCRATCH) == NULL) {
+        printf("No scratch device, discarding trace.\n");
+        return;
+    }
+
+    /* Put the oldest record first by rotating the buffer left by HEAD. */
+    if (wrapped) {
+        reverse_records(records, head);
+        reverse_records(records + head, record_max - head);
+        reverse_records(records, record_max);
+        cnt = record_max;
+    }
+    else
+        cnt = head;
+
+    memset(header, 0, sizeof *header);
+    memcpy(header->magic, "PTRC", sizeof header->magic);
+    header->version = TRACE_VERSION;
+    header->record_size = sizeof *records;
+    header->record_cnt = cnt;
+    header->lost_cnt = lost_cnt;
+
+    printf("Writing %zu trace records (%"PRIu32" lost) to scratch device...\n",
+           cnt, lost_cnt);
+    fsutil_append_buffer("trace", header,
+                         sizeof *header + cnt * sizeof *records);
+}
+#else /* !FILESYS */
+/*! Without a file system there is no scratch device to write to. */
+void trace_dump(void) {
+}
+#endif
@@ -0,0 +1,65 @@
+/*! \file trace.h
+ *
+ * Declarations for kernel static tracepoints.
+ */
+
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*! Trace events.  The meaning of each event's two arguments is given
+    beside it.  utils/trace2json knows these numbers, so only append. */
+enum trace_event {
+    TRACE_SCHEDULE,             /*!< Switched in: previous tid, its status. */
+    TRACE_PAGE_FAULT,           /*!< Page fault: address, error code. */
+    TRACE_FRAME_EVICT,          /*!< Frame evicted: user page, owner tid. */
+    TRACE_SWAP_ADD,             /*!< Page swapped out: kernel page, sector. */
+    TRACE_BLOCK_READ,           /*!< Sector read: sector, block type. */
+    TRACE_BLOCK_WRITE,          /*!< Sector written: sector, block type. */
+    TRACE_SYSCALL_ENTER,        /*!< System call entry: number, user eip. */
+    TRACE_SYSCALL_EXIT          /*!< System call return: number, eax. */
+};
+
+/*! A trace record, as written to the trace file. */
+struct trace_record {
+    int64_t time;               /*!< timer_now_ns() at the event. */
+    uint32_t event;             /*!< One of enum trace_event. */
+    int32_t tid;                /*!< Running thread. */
+    uint32_t arg0;              /*!< First argument. */
+    uint32_t arg1;              /*!< Second argument. */
+};
+
+/*! Header at the start of the trace file, followed by RECORD_CNT records,
+    oldest first. */
+struct trace_header {
+    char magic[4];              /*!< "PTRC". */
+    uint32_t version;           /*!< TRACE_VERSION. */
+    uint32_t record_size;       /*!< sizeof (struct trace_record). */
+    uint32_t record_cnt;        /*!< Number of records that follow. */
+    uint32_t lost_cnt;          /*!< Older records overwritten. */
+    uint32_t reserved;          /*!< Zero. */
+};
+
+/*! Trace file format version. */
+#define TRACE_VERSION 1
+
+/*! Record events?
+    Controlled by kernel command-line option "-trace". */
+extern bool trace_enabled;
+
+/*! Records EVENT with arguments ARG0 and ARG1, which may be integers or
+    pointers.  Costs a single test of trace_enabled when tracing is off. */
+#define TRACE(EVENT, ARG0, ARG1)                                        \
+        do {                                                            \
+            if (trace_enabled)                                          \
+                trace_event((EVENT), (uint32_t) (ARG0),                 \
+                            (uint32_t) (ARG1));                         \
+        } while (0)
+
+void trace_init(void);
+void trace_event(enum trace_event, uint32_t arg0, uint32_t arg1);
+void trace_dump(void);
+
+#endif /* threads/trace.h */
@@ -0,0 +1,155 @@
+/*! \file workqueue.c
+ *
+ * Worker thread pools for deferred work.
+ *
+ * A work item is queued with a priority and is kept on its workqueue's
+ * item list in priority order, FIFO among equal priorities.  Queueing only
+ * disables interrupts and ups a semaphore, so it may be done from an
+ * interrupt handler.  Each worker thread sleeps on that semaphore; when it
+ * wakes it takes up to WQ_BATCH items off the front of the list in one go
+ * and runs them, taking on the priority of each item while the item
+ * runs.
+ */
+
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+static void worker(void *wq_);
+static bool work_priority_less(const struct list_elem *a,
+                               const struct list_elem *b, void *aux);
+
+/*! Initializes work item W to call FUNC with AUX when it runs. */
+void work_init(struct work *w, work_func *func, void *aux) {
+    ASSERT(w != NULL);
+    ASSERT(func != NULL);
+
+    w->func = func;
+    w->aux = aux;
+    w->priority = PRI_DEFAULT;
+    w->pending = false;
+}
+
+/*! Initializes WQ and starts WORKERS worker threads for it at PRIORITY.
+    NAME is used to name the workers, so it must remain valid as long as WQ
+    is in use.  Returns true if at least one worker could be started. */
+bool workqueue_init(struct workqueue *wq, const char *name, int workers,
+                    int priority) {
+    char thread_name[16];
+    int i;
+
+    ASSERT(wq != NULL);
+    ASSERT(workers > 0 && workers <= WQ_MAX_WORKERS);
+    ASSERT(priority >= PRI_MIN && priority <= PRI_MAX);
+
+    wq->name = name;
+    list_init(&wq->items);
+    sema_init(&wq->ready, 0);
+    wq->worker_cnt = 0;
+
+    for (i = 0; i < workers; i++) {
+        snprintf(thread_name, sizeof thread_name, "%s/%d", name, i);
+        if (thread_create(thread_name, priority, worker, wq) == TID_ERROR)
+            break;
+        wq->worker_cnt++;
+    }
+    return wq->worker_cnt > 0;
+}
+
+/*! Queues W on WQ to be run at PRIORITY.  Returns false, without changing
+    anything, if W is already pending.  May be called from an interrupt
+    handler. */
+bool workqueue_queue(struct workqueue *wq, struct work *w, int priority) {
+    enum intr_level old_level;
+
+    ASSERT(wq != NULL && w != NULL);
+    ASSERT(priority >= PRI_MIN && priority <= PRI_MAX);
+
+    old_level = intr_disable();
+    if (w->pending) {
+        intr_set_level(old_level);
+        return false;
+    }
+    w->priority = priority;
+    w->pending = true;
+    list_insert_ordered(&wq->items, &w->elem, work_priority_less, NULL);
+    intr_set_level(old_level);
+
+    sema_up(&wq->ready);
+    return true;
+}
+
+/*! Removes W from WQ if it has not started running yet.  Returns true if it
+    was removed, false if it was not pending. */
+bool workqueue_cancel(struct workqueue *wq, struct work *w) {
+    enum intr_level old_level;
+    bool cancelled = false;
+
+    ASSERT(wq != NULL && w != NULL);
+
+    old_level = intr_disable();
+    /* Every pending item accounts for one up of wq->ready.  If there is
+       none left to take back, a worker has already claimed this item and
+       will run it. */
+    if (w->pending && sema_try_down(&wq->ready)) {
+        list_remove(&w->elem);
+        w->pending = false;
+        cancelled = true;
+    }
+    intr_set_level(old_level);
+    return cancelled;
+}
+
+/*! Orders work items by descending priority.  Items of equal priority
+    compare equal, so list_insert_ordered() keeps them in FIFO order. */
+static bool work_priority_less(const struct list_elem *a,
+                               const struct list_elem *b, void *aux UNUSED) {
+    return list_entry(a, struct work, elem)->priority >
+           list_entry(b, struct work, elem)->priority;
+}
+
+/*! Worker thread body.  Repeatedly takes a batch of items off WQ_ and runs
+    them.  Never returns. */
+static void worker(void *wq_) {
+    struct workqueue *wq = wq_;
+    work_func *funcs[WQ_BATCH];
+    void *auxes[WQ_BATCH];
+    int priorities[WQ_BATCH];
+    struct thread *cur = thread_current();
+    int base_priority = cur->priority;
+    enum intr_level old_level;
+    struct work *w;
+    int cnt, i;
+
+    for (;;) {
+        /* Wait for one item, then take whatever else is already queued up
+           to the batch size without sleeping again. */
+        sema_down(&wq->ready);
+        old_level = intr_disable();
+        cnt = 0;
+        do {
+            ASSERT(!list_empty(&wq->items));
+            w = list_entry(list_pop_front(&wq->items), struct work, elem);
+            w->pending = false;
+            funcs[cnt] = w->func;
+            auxes[cnt] = w->aux;
+            priorities[cnt] = w->priority;
+            cnt++;
+        } while (cnt < WQ_BATCH && sema_try_down(&wq->ready));
+        intr_set_level(old_level);
+
+        /* The items were copied out and marked not pending, so each
+           function is free to requeue or free its own work item.  Under
+           MLFQS the scheduler owns thread priorities, so items simply run
+           at the worker's. */
+        for (i = 0; i < cnt; i++) {
+            if (!get_thread_mlfqs() && cur->priority != priorities[i])
+                thread_set_priority(priorities[i]);
+            funcs[i](auxes[i]);
+        }
+        if (!get_thread_mlfqs() && cur->priority != base_priority)
+            thread_set_priority(base_priority);
+    }
+}
@@ -0,0 +1,48 @@
+/*! \file workqueue.h
+ *
+ * Data structures and function declarations for workqueues, which let
+ * interrupt handlers and latency-sensitive paths hand work off to a pool of
+ * kernel worker threads.
+ */
+
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include "threads/synch.h"
+
+/*! Maximum number of items a worker takes off its queue at once. */
+#define WQ_BATCH 8
+
+/*! Maximum number of worker threads per workqueue. */
+#define WQ_MAX_WORKERS 8
+
+/*! Function run by a worker thread for a queued work item. */
+typedef void work_func(void *aux);
+
+/*! A deferred work item.  The caller owns the memory; the workqueue only
+    links it in while it is pending. */
+struct work {
+    work_func *func;            /*!< Function to run. */
+    void *aux;                  /*!< Argument passed to func. */
+    int priority;               /*!< Dispatch priority, PRI_MIN to PRI_MAX. */
+    bool pending;               /*!< Queued and not yet started? */
+    struct list_elem elem;      /*!< Element in workqueue's items list. */
+};
+
+/*! A queue of work items and the worker threads that run them. */
+struct workqueue {
+    const char *name;           /*!< Name, for worker thread names. */
+    struct list items;          /*!< Pending items, highest priority first. */
+    struct semaphore ready;     /*!< One up per pending item. */
+    int worker_cnt;             /*!< Number of worker threads. */
+};
+
+void work_init(struct work *, work_func *, void *aux);
+bool workqueue_init(struct workqueue *, const char *name, int workers,
+                    int priority);
+bool workqueue_queue(struct workqueue *, struct work *, int priority);
+bool workqueue_cancel(struct workqueue *, struct work *);
+
+#endif /* threads/workqueue.h */
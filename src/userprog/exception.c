@@ -5,8 +5,10 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "userprog/syscall.h"
 #include "vm/frame.h"
 #include "vm/page.h"
@@ -94,8 +96,7 @@ static void kill(struct intr_frame *f) {
         printf("%s: dying due to interrupt %#04x (%s).\n",
                thread_name(), f->vec_no, intr_name(f->vec_no));
         intr_dump_frame(f);
-//         thread_exit(); 
-        exit(-1);
+        process_kill();
 
     case SEL_KCSEG:
         /* Kernel's code segment, which indicates a kernel bug.
@@ -158,6 +159,12 @@ static void page_fault(struct intr_frame *f) {
     not_present = (f->error_code & PF_P) == 0;
     write = (f->error_code & PF_W) != 0;
     user = (f->error_code & PF_U) != 0;
+    TRACE(TRACE_PAGE_FAULT, fault_addr, f->error_code);
+
+    /* A thread of a process that is going away does not get its page. */
+    if (user) {
+        process_check_exit();
+    }
 
 #ifdef VM
     /* If we pagefaulted in kernel code, let's  assume we were coming from
@@ -178,16 +185,19 @@ static void page_fault(struct intr_frame *f) {
         /* Iterate through the current thread's supplemental page table to 
            find if the faulting address is valid. */
 
+        spt_lock(t);
         found_valid = spt_present(t, pg_round_down(fault_addr));
-
-        /* If it's in our suplemental page table */
         if (found_valid) {
             vma = spt_get_struct(t, pg_round_down(fault_addr));
             vma->pinned = true;
-            new_page = palloc_get_page(PAL_USER); 
-            if (new_page == NULL) {
-                new_page = frame_evict();
-            }
+        }
+        spt_unlock(t);
+
+        /* If it's in our suplemental page table */
+        if (found_valid) {
+            /* The page may still be on its way out. */
+            frame_wait_evict(vma);
+            new_page = frame_alloc(0);
             if (vma->pg_type == FILE_SYS) {
                 /* Read the file into the kernel page. If we do not read the
                    PGSIZE bytes, then zero out the rest of the page. */
@@ -235,20 +245,22 @@ static void page_fault(struct intr_frame *f) {
                              new_page, vma->writable)) {
                 kill(f);
             }
+            /* A mmap'd page that had to go to swap still differs from its
+               file; keep it dirty so it is written back later. */
+            if (vma->mmapped && vma->pg_type == PMEM) {
+                pagedir_set_dirty(t->pagedir, pg_round_down(fault_addr), true);
+            }
         }
         else {
             /* Handling stack extension */
             if ((fault_addr == esp - 4) || (fault_addr == esp - 32)) {
                 /* Check for stack overflow */
                 if (fault_addr < STACK_MIN) {
-                    exit(-1);
+                    process_kill();
                 }
 
                 /* If we're here, let's give this process another page */
-                new_page = palloc_get_page(PAL_ZERO | PAL_USER);
-                if (new_page == NULL) {
-                    new_page = frame_evict();
-                }
+                new_page = frame_alloc(PAL_ZERO);
                 if (!pagedir_set_page(t->pagedir, pg_round_down(fault_addr),
                                  new_page, 1)) {
                     kill(f);
@@ -265,6 +277,8 @@ static void page_fault(struct intr_frame *f) {
                 vma->pg_read_bytes = NULL;
                 vma->writable = true;
                 vma->pinned = true;
+                vma->evicting = false;
+                vma->mmapped = false;
                 vma->vm_file = NULL;
                 vma->ofs = NULL;
                 vma->swap_ind = NULL;
@@ -276,10 +290,7 @@ static void page_fault(struct intr_frame *f) {
             }
             /* Other case of stack extension */
             else if (fault_addr >= esp) {
-                new_page = palloc_get_page(PAL_ZERO | PAL_USER);
-                if (new_page == NULL) {
-                    new_page = frame_evict();
-                }
+                new_page = frame_alloc(PAL_ZERO);
                 if (!pagedir_set_page(t->pagedir, pg_round_down(fault_addr),
                                  new_page, 1)) {
                     kill(f);
@@ -296,6 +307,8 @@ static void page_fault(struct intr_frame *f) {
                 vma->pg_read_bytes = NULL;
                 vma->writable = true;
                 vma->pinned = true;
+                vma->evicting = false;
+                vma->mmapped = false;
                 vma->vm_file = NULL;
                 vma->ofs = NULL;
                 vma->swap_ind = NULL;
@@ -308,13 +321,13 @@ static void page_fault(struct intr_frame *f) {
             
             /* Else is probably an invalid access */
             else {
-                exit(-1);
+                process_kill();
             }
         }
     }
     /* Rights violation */
     else {
-        exit(-1);
+        process_kill();
     }
 
 #else
@@ -0,0 +1,178 @@
+/*! \file futex.c
+ *
+ * Fast user-space mutexes.
+ *
+ * A futex is just an int in user memory.  User code manipulates it with
+ * atomic instructions and only enters the kernel to sleep when the lock is
+ * contended (futex_block()) or to wake sleepers (futex_wakeup()).  Sleepers
+ * are kept in a fixed set of hash buckets keyed by user address; since the
+ * threads of a process share one page directory, a waiter matches a wake
+ * only if both the address and the page directory agree.
+ *
+ * Each bucket has a lock that makes futex_block()'s check of the value and
+ * its enqueue atomic with respect to wakers.  The value is read with
+ * interrupts on, under that lock, because the page holding it may have been
+ * paged out and reading it may fault and sleep.  The waiter then blocks
+ * with interrupts off only if no waker has dequeued it in the meantime.
+ */
+
+#include "userprog/futex.h"
+#include <debug.h>
+#include <list.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/*! Number of wait queue buckets. */
+#define FUTEX_BUCKETS 64
+
+/*! A thread sleeping in futex_block().  Lives on the sleeper's stack. */
+struct futex_waiter {
+    uint32_t *pagedir;                  /*!< Address space of UADDR. */
+    const int *uaddr;                   /*!< User address waited on. */
+    struct thread *thread;              /*!< The sleeping thread. */
+    bool woken;                         /*!< Dequeued by a waker? */
+    bool sleeping;                      /*!< In thread_block()? */
+    struct list_elem elem;              /*!< Element in a bucket. */
+};
+
+/*! A wait queue and the lock serializing its waiters and wakers. */
+struct futex_bucket {
+    struct lock lock;                   /*!< Held across check and enqueue. */
+    struct list waiters;                /*!< Protected by interrupts off. */
+};
+
+/*! Wait queues, hashed by user address. */
+static struct futex_bucket buckets[FUTEX_BUCKETS];
+
+/*! Returns the bucket for waiters on UADDR. */
+static struct futex_bucket *bucket_of(const int *uaddr) {
+    return &buckets[((uintptr_t) uaddr / sizeof(int)) % FUTEX_BUCKETS];
+}
+
+/*! Initializes the futex wait queues. */
+void futex_init(void) {
+    int i;
+
+    for (i = 0; i < FUTEX_BUCKETS; i++) {
+        lock_init(&buckets[i].lock);
+        list_init(&buckets[i].waiters);
+    }
+}
+
+/*! Removes W from its bucket and wakes it.  If W has not reached
+    thread_block() yet, it sees W->woken and does not block at all.  Must be
+    called with interrupts off. */
+static void wake_waiter(struct futex_waiter *w) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    list_remove(&w->elem);
+    w->woken = true;
+    if (w->sleeping)
+        thread_unblock(w->thread);
+}
+
+/*! If the int at user address UADDR still holds VAL, sleeps until a
+    futex_wakeup() on UADDR and returns 0.  Otherwise returns -1 at once,
+    as it also does if the process is exiting.  UADDR must be a valid,
+    aligned user address.  Must be called with interrupts on. */
+int futex_block(const int *uaddr, int val) {
+    struct thread *cur = thread_current();
+    struct futex_bucket *b = bucket_of(uaddr);
+    struct futex_waiter w;
+    enum intr_level old_level;
+
+    /* Touch UADDR before taking the bucket lock, so that a bad address
+       kills the process here rather than with the lock held.  The read
+       below may still fault, but only to page the value back in. */
+    (void) *(volatile const int *) uaddr;
+
+    lock_acquire(&b->lock);
+    if (*(volatile const int *) uaddr != val ||
+        cur->process_details->exiting) {
+        lock_release(&b->lock);
+        return -1;
+    }
+
+    w.pagedir = cur->pagedir;
+    w.uaddr = uaddr;
+    w.thread = cur;
+    w.woken = false;
+    w.sleeping = false;
+    old_level = intr_disable();
+    list_push_back(&b->waiters, &w.elem);
+    intr_set_level(old_level);
+
+    /* Releasing the lock may switch to a waker, which dequeues us before we
+       block; W.woken tells us not to. */
+    lock_release(&b->lock);
+    old_level = intr_disable();
+    if (!w.woken) {
+        w.sleeping = true;
+        thread_block();
+    }
+    intr_set_level(old_level);
+    return 0;
+}
+
+/*! Wakes up to COUNT threads of the current process sleeping on UADDR, in
+    the order they went to sleep.  Returns the number woken. */
+int futex_wakeup(const int *uaddr, int count) {
+    struct futex_bucket *b = bucket_of(uaddr);
+    uint32_t *pagedir = thread_current()->pagedir;
+    struct list_elem *e;
+    enum intr_level old_level;
+    bool yield = false;
+    int woken = 0;
+
+    lock_acquire(&b->lock);
+    old_level = intr_disable();
+    for (e = list_begin(&b->waiters);
+         e != list_end(&b->waiters) && woken < count; ) {
+        struct futex_waiter *w = list_entry(e, struct futex_waiter, elem);
+
+        e = list_next(e);
+        if (w->uaddr == uaddr && w->pagedir == pagedir) {
+            yield = yield || thread_should_preempt(w->thread);
+            wake_waiter(w);
+            woken++;
+        }
+    }
+    intr_set_level(old_level);
+    lock_release(&b->lock);
+
+    if (yield)
+        thread_yield();
+    return woken;
+}
+
+/*! Wakes every thread sleeping on any futex in the address space PAGEDIR.
+    Used when a process exits, after marking it as exiting; taking each
+    bucket lock ensures no thread of it is between its check of the exiting
+    flag and its enqueue. */
+void futex_wake_all(uint32_t *pagedir) {
+    enum intr_level old_level;
+    int i;
+
+    for (i = 0; i < FUTEX_BUCKETS; i++) {
+        struct futex_bucket *b = &buckets[i];
+        bool held = lock_held_by_current_thread(&b->lock);
+        struct list_elem *e;
+
+        /* A thread killed by a fault inside futex_block() holds its
+           bucket's lock already; it never returns there, so drop the lock
+           for it below. */
+        if (!held)
+            lock_acquire(&b->lock);
+        old_level = intr_disable();
+        for (e = list_begin(&b->waiters); e != list_end(&b->waiters); ) {
+            struct futex_waiter *w = list_entry(e, struct futex_waiter, elem);
+
+            e = list_next(e);
+            if (w->pagedir == pagedir)
+                wake_waiter(w);
+        }
+        intr_set_level(old_level);
+        lock_release(&b->lock);
+    }
+}
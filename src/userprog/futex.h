@@ -0,0 +1,11 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdint.h>
+
+void futex_init(void);
+int futex_block(const int *uaddr, int val);
+int futex_wakeup(const int *uaddr, int count);
+void futex_wake_all(uint32_t *pagedir);
+
+#endif /* userprog/futex.h */
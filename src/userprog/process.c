@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/futex.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/syscall.h"
@@ -24,6 +25,7 @@
 
 
 static thread_func start_process NO_RETURN;
+static thread_func start_thread NO_RETURN;
 static bool load(int argc, const char **argv, void (**eip)(void), void **esp);
 char **tokenize_process_args(const char *raw_args, int *argc);
 extern struct list all_list;
@@ -115,8 +117,7 @@ static void start_process(void *raw_args_) {
     int argc, stack_constants, raw_args_size;
     struct intr_frame if_;
     bool success;
-    struct list_elem *e;
-    struct thread *iter;
+    struct thread *parent;
 
     /* Initialize interrupt frame and load executable. */
     memset(&if_, 0, sizeof(if_));
@@ -148,36 +149,32 @@ static void start_process(void *raw_args_) {
     if (!success) {
         palloc_free_page(argv);
 
-        /* Loop through all threads to find this guy's parent */
-        for (e = list_begin(&all_list); e != list_end(&all_list); 
-             e = list_next(e)) {
-            iter = list_entry(e, struct thread, allelem);
-            if (iter->tid == thread_current()->process_details->parent_id) {
-                /* Tell the parent that there was an error */
-                iter->child_loaded_error = 1;
+        /* Find this guy's parent */
+        rcu_read_lock();
+        parent = thread_lookup(thread_current()->process_details->parent_id);
+        if (parent != NULL) {
+            /* Tell the parent that there was an error */
+            parent->child_loaded_error = 1;
 
-                /* Signal the parent that there's an update */
-                sema_up(iter->child_loaded_sema);
-                break;
-            } 
+            /* Signal the parent that there's an update */
+            sema_up(parent->child_loaded_sema);
         }
+        rcu_read_unlock();
         exit(-1);
     }
 
 
-    /* Loop through all threads to find this guy's parent */
-    for (e = list_begin(&all_list); e != list_end(&all_list); 
-         e = list_next(e)) {
-        iter = list_entry(e, struct thread, allelem);
-        if (iter->tid == thread_current()->process_details->parent_id) {
-            /* Tell the parent that there was NO error */
-            iter->child_loaded_error = 0;
+    /* Find this guy's parent */
+    rcu_read_lock();
+    parent = thread_lookup(thread_current()->process_details->parent_id);
+    if (parent != NULL) {
+        /* Tell the parent that there was NO error */
+        parent->child_loaded_error = 0;
 
-            /* Signal the parent that there's an update */
-            sema_up(iter->child_loaded_sema);
-            break;
-        } 
+        /* Signal the parent that there's an update */
+        sema_up(parent->child_loaded_sema);
     }
+    rcu_read_unlock();
 
     /* Start the user process by simulating a return from an
        interrupt, implemented by intr_exit (in
@@ -210,6 +207,11 @@ void process_exit(void) {
        to the kernel-only page directory. */
     pd = cur->pagedir;
     if (pd != NULL) {
+#ifdef VM
+        /* pagedir_destroy() frees our frames, so forget them first, while
+           eviction can still look at our page directory. */
+        frame_remove_thread(cur);
+#endif
         /* Correct ordering here is crucial.  We must set
            cur->pagedir to NULL before switching page directories,
            so that a timer interrupt can't switch back to the
@@ -223,6 +225,249 @@ void process_exit(void) {
     }
 }
 
+/*! Arguments passed from process_thread_create() to start_thread(). */
+struct thread_start {
+    struct process *process;            /*!< Process to join. */
+    uint32_t *pagedir;                  /*!< Its page directory. */
+    struct uthread *slot;               /*!< Slot reserved for the thread. */
+    void *eip;                          /*!< User entry point. */
+    void *esp;                          /*!< User stack pointer. */
+    struct semaphore started;           /*!< Upped once args are consumed. */
+};
+
+/*! Starts a user thread in the current process, entering user code at EIP
+    with the stack pointer at ESP.  Returns the new thread's tid, or
+    TID_ERROR if the process is out of thread slots, is exiting, or the
+    thread cannot be created. */
+tid_t process_thread_create(void *eip, void *esp) {
+    struct thread *cur = thread_current();
+    struct process *p = cur->process_details;
+    struct thread_start args;
+    enum intr_level old_level;
+    tid_t tid;
+    int i;
+
+    args.slot = NULL;
+    old_level = intr_disable();
+    for (i = 0; i < MAX_USER_THREADS && !p->exiting; i++) {
+        if (!p->threads[i].in_use) {
+            args.slot = &p->threads[i];
+            args.slot->in_use = true;
+            args.slot->joining = false;
+            args.slot->detached = false;
+            args.slot->exited = false;
+            args.slot->tid = TID_ERROR;
+            sema_init(&args.slot->done, 0);
+            /* Counted now, so an exiting leader waits for it. */
+            p->num_threads++;
+            break;
+        }
+    }
+    intr_set_level(old_level);
+    if (args.slot == NULL)
+        return TID_ERROR;
+
+    args.process = p;
+    args.pagedir = p->leader->pagedir;
+    args.eip = eip;
+    args.esp = esp;
+    sema_init(&args.started, 0);
+
+    tid = thread_create(cur->name, PRI_DEFAULT, start_thread, &args);
+    if (tid == TID_ERROR) {
+        old_level = intr_disable();
+        args.slot->in_use = false;
+        p->num_threads--;
+        intr_set_level(old_level);
+        return TID_ERROR;
+    }
+    sema_down(&args.started);
+    return tid;
+}
+
+/*! A thread function that turns a new kernel thread into a user thread of
+    an existing process and jumps to user code. */
+static void start_thread(void *args_) {
+    struct thread_start *args = args_;
+    struct thread *cur = thread_current();
+    struct intr_frame if_;
+
+    /* Trade the process thread_create() gave us for the shared one. */
+    palloc_free_page(cur->process_details);
+    cur->process_details = args->process;
+    cur->pagedir = args->pagedir;
+    args->slot->tid = cur->tid;
+    process_activate();
+
+    memset(&if_, 0, sizeof(if_));
+    if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+    if_.cs = SEL_UCSEG;
+    if_.eflags = FLAG_IF | FLAG_MBS;
+    if_.eip = args->eip;
+    if_.esp = args->esp;
+    sema_up(&args->started);
+
+    /* See start_process(). */
+    asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+    NOT_REACHED();
+}
+
+/*! Waits for user thread TID of the current process to exit and returns
+    its exit status, or -1 if TID is not a user thread of this process, is
+    detached, or is already being joined. */
+int process_thread_join(tid_t tid) {
+    struct process *p = thread_current()->process_details;
+    struct uthread *slot = NULL;
+    enum intr_level old_level;
+    int status;
+    int i;
+
+    /* Checked first, so that a self-join does not claim the slot. */
+    if (tid == thread_tid())
+        return -1;
+
+    old_level = intr_disable();
+    for (i = 0; i < MAX_USER_THREADS; i++) {
+        if (p->threads[i].in_use && p->threads[i].tid == tid &&
+            !p->threads[i].joining && !p->threads[i].detached) {
+            slot = &p->threads[i];
+            slot->joining = true;
+            break;
+        }
+    }
+    intr_set_level(old_level);
+    if (slot == NULL)
+        return -1;
+
+    sema_down(&slot->done);
+    status = slot->status;
+    slot->in_use = false;
+    return status;
+}
+
+/*! Detaches user thread TID of the current process: no one may join it any
+    more, and its slot is freed as soon as it exits, or now if it already
+    has.  Returns 0 on success, or -1 if TID is not a user thread of this
+    process, is already detached, or is being joined. */
+int process_thread_detach(tid_t tid) {
+    struct process *p = thread_current()->process_details;
+    struct uthread *slot;
+    enum intr_level old_level;
+    int result = -1;
+    int i;
+
+    old_level = intr_disable();
+    for (i = 0; i < MAX_USER_THREADS; i++) {
+        slot = &p->threads[i];
+        if (slot->in_use && slot->tid == tid && !slot->joining &&
+            !slot->detached) {
+            if (slot->exited)
+                slot->in_use = false;
+            else
+                slot->detached = true;
+            result = 0;
+            break;
+        }
+    }
+    intr_set_level(old_level);
+    return result;
+}
+
+/*! Records the exit of the current thread, a user thread, for
+    process_thread_join() and the process leader, or frees its slot if it
+    was detached.  Called by thread_exit() with interrupts off. */
+void process_thread_exit(void) {
+    struct thread *cur = thread_current();
+    struct process *p = cur->process_details;
+    int i;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(p->leader != cur);
+
+    for (i = 0; i < MAX_USER_THREADS; i++) {
+        if (p->threads[i].in_use && p->threads[i].tid == cur->tid) {
+            if (p->threads[i].detached) {
+                p->threads[i].in_use = false;
+                break;
+            }
+            p->threads[i].exited = true;
+            p->threads[i].status = cur->exit_status;
+            sema_up(&p->threads[i].done);
+            break;
+        }
+    }
+    p->num_threads--;
+    sema_up(&p->threads_gone);
+
+    /* The page directory belongs to the leader. */
+    cur->pagedir = NULL;
+    cur->process_details = NULL;
+}
+
+/*! Called by the leader of a process on its way out: marks the process's
+    other threads for death, wakes those blocked on a futex, and waits until
+    they have all exited.  Each of them exits the next time it would return
+    to user code, whether from a system call, a page fault or a timer
+    interrupt, so a thread spinning in user code does not hold this up. */
+void process_exit_threads(void) {
+    struct thread *cur = thread_current();
+    struct process *p = cur->process_details;
+
+    ASSERT(p->leader == cur);
+
+    p->exiting = true;
+    futex_wake_all(cur->pagedir);
+    while (p->num_threads > 1)
+        sema_down(&p->threads_gone);
+}
+
+/*! Exits the current thread if its process is going away: a user thread
+    just exits, and a leader exits the whole process with the status left
+    by process_kill().  Called whenever a thread of a user process is about
+    to return to user code, and at the start of system calls and page
+    faults.  Interrupts may be on or off. */
+void process_check_exit(void) {
+    struct thread *cur = thread_current();
+    struct process *p = cur->process_details;
+
+    if (p == NULL || !p->exiting || cur->pagedir == NULL)
+        return;
+
+    intr_enable();
+    exit(p->leader == cur ? p->exit_status : -1);
+}
+
+/*! Terminates the current process with status -1 after one of its threads
+    has faulted.  A user thread cannot tear the process down itself, so it
+    marks the process for death, wakes the leader if it is blocked on a
+    futex, and exits; the leader then exits at its next return to user
+    code. */
+void process_kill(void) {
+    struct thread *cur = thread_current();
+    struct process *p = cur->process_details;
+    enum intr_level old_level;
+
+    if (p->leader != cur) {
+        old_level = intr_disable();
+        if (!p->exiting) {
+            p->exiting = true;
+            p->exit_status = -1;
+        }
+        intr_set_level(old_level);
+        futex_wake_all(cur->pagedir);
+    }
+    exit(-1);
+    NOT_REACHED();
+}
+
+/*! Returns the thread whose page directory and supplemental page table T
+    uses: its process leader if T is a user thread, otherwise T itself. */
+struct thread *process_leader(struct thread *t) {
+    if (t->process_details != NULL && t->process_details->leader != NULL)
+        return t->process_details->leader;
+    return t;
+}
+
 /*! Sets up the CPU for running user code in the current thread.
     This function is called on every context switch. */
 void process_activate(void) {
@@ -497,6 +742,8 @@ static bool load_segment(struct file *file, off_t ofs, uint8_t *upage,
         vma->vm_end = upage + PGSIZE - sizeof(uint8_t);
         vma->writable = writable;
         vma->pinned = 0;
+        vma->evicting = false;
+        vma->mmapped = false;
         vma->vm_file = file;
         /* Store the current offset within the file. */
         vma->ofs = ofs;
@@ -557,14 +804,14 @@ static bool setup_stack(void **esp, int argc, char **argv) {
     struct vm_area_struct *vma;
     int i;
 
-    kpage = palloc_get_page(PAL_USER | PAL_ZERO);
-    if (kpage == NULL) {
 #ifdef VM
-        kpage = (uint8_t *) frame_evict();
+    kpage = (uint8_t *) frame_alloc(PAL_ZERO);
 #else
+    kpage = palloc_get_page(PAL_USER | PAL_ZERO);
+    if (kpage == NULL) {
         return success;
-#endif
     }
+#endif
 
     upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
     success = install_page(upage, kpage, true);
@@ -578,6 +825,8 @@ static bool setup_stack(void **esp, int argc, char **argv) {
         vma->pg_read_bytes = NULL;
         vma->writable = true;
         vma->pinned = false;
+        vma->evicting = false;
+        vma->mmapped = false;
         vma->vm_file = NULL;
         vma->ofs = NULL;
         vma->swap_ind = NULL;
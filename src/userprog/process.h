@@ -1,6 +1,7 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <debug.h>
 #include "threads/thread.h"
 
 tid_t process_execute(const char *file_name);
@@ -8,5 +9,14 @@ int process_wait(tid_t);
 void process_exit(void);
 void process_activate(void);
 
+tid_t process_thread_create(void *eip, void *esp);
+int process_thread_join(tid_t);
+int process_thread_detach(tid_t);
+void process_thread_exit(void);
+void process_exit_threads(void);
+void process_check_exit(void);
+void process_kill(void) NO_RETURN;
+struct thread *process_leader(struct thread *t);
+
 #endif /* userprog/process.h */
 
@@ -1,9 +1,13 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/cpugroup.h"
+#include "threads/lockstat.h"
 #include "threads/palloc.h"
+#include "threads/trace.h"
 #include "devices/shutdown.h"
 
 #include "threads/vaddr.h"
@@ -16,6 +20,7 @@
 
 #include "devices/input.h"
 
+#include "userprog/futex.h"
 #include "userprog/process.h"
 
 #include "threads/malloc.h"
@@ -31,6 +36,9 @@ extern void palloc_free_page (void *);
  */
 bool valid_user_pointer(const void *ptr);
 
+/* Validates a user-provided buffer of size bytes, page by page. */
+bool valid_user_range(const void *ptr, size_t size);
+
 /* Checks if a file is open */
 bool file_is_open(int fd);
 
@@ -49,7 +57,6 @@ extern struct lock frame_lock;
 
 /* Global thread lists */
 extern struct list dead_list;
-extern struct list all_list;
 
 
 /* Validates a user-provided pointer. Checks that it's in the required
@@ -92,6 +99,29 @@ bool valid_user_pointer(const void *ptr) {
 
 /* Helper functions for files related to process. */
 
+/* Validates the user-provided buffer of size bytes at ptr: it must not wrap
+ * around or reach into kernel space, and each of its pages must pass
+ * valid_user_pointer().
+ */
+bool valid_user_range(const void *ptr, size_t size) {
+    const uint8_t *start = ptr;
+    const uint8_t *last = start + size - 1;
+    const uint8_t *page;
+
+    if (size == 0) {
+        return true;
+    }
+    if (last < start || !is_user_vaddr(last)) {
+        return false;
+    }
+    for (page = pg_round_down(start); page <= last; page += PGSIZE) {
+        if (!valid_user_pointer(page < start ? start : page)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /* Checks if a file is open */
 bool file_is_open(int fd) {
     bool opn = false;
@@ -117,6 +147,7 @@ struct file * get_file_struct(int fd) {
 
 /* Installs the syscall_handler into the interrupt vector table. */
 void syscall_init(void) {
+    futex_init();
     intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -131,6 +162,9 @@ static void syscall_handler(struct intr_frame *f UNUSED) {
     /* Store esp in thread struct */
     thread_current()->esp = esp;
 
+    /* The threads of an exiting process go no further. */
+    process_check_exit();
+
     /* Check validity of syscall_nr */
     if (!valid_user_pointer(esp)) {
         exit(EXIT_BAD_PTR);
@@ -138,6 +172,7 @@ static void syscall_handler(struct intr_frame *f UNUSED) {
 
     /* Extract syscall numbers and arguments */
     int syscall_nr = *((int *)f->esp);
+    TRACE(TRACE_SYSCALL_ENTER, syscall_nr, f->eip);
 
     void *arg1 = (void *) ((int *)(f->esp + 4));
     void *arg2 = (void *) ((int *)(f->esp + 8));
@@ -261,10 +296,89 @@ static void syscall_handler(struct intr_frame *f UNUSED) {
             munmap(*((mapid_t *) arg1));
             break;
 
+        case SYS_SCHEDSTAT:
+            if ((!valid_user_pointer(arg1)) || (!valid_user_pointer(arg2))) {
+                exit(EXIT_BAD_PTR);
+            }
+            f->eax = schedstat(*((pid_t *) arg1),
+                               *((struct schedstat **) arg2));
+            break;
+
+        case SYS_LOCKSTAT:
+            if ((!valid_user_pointer(arg1)) || (!valid_user_pointer(arg2))) {
+                exit(EXIT_BAD_PTR);
+            }
+            f->eax = lockstat(*((struct lockstat **) arg1), *((int *) arg2));
+            break;
+
+        case SYS_SCHED_SETDEADLINE:
+            if ((!valid_user_pointer(arg1)) ||
+                (!valid_user_pointer(arg2)) ||
+                (!valid_user_pointer(arg3))) {
+                exit(EXIT_BAD_PTR);
+            }
+            f->eax = sched_setdeadline(*((unsigned *) arg1),
+                                       *((unsigned *) arg2),
+                                       *((unsigned *) arg3));
+            break;
+
+        case SYS_CPUGROUP_CREATE:
+            if ((!valid_user_pointer(arg1)) || (!valid_user_pointer(arg2))) {
+                exit(EXIT_BAD_PTR);
+            }
+            f->eax = cpugroup_create(*((unsigned *) arg1),
+                                     *((unsigned *) arg2));
+            break;
+
+        case SYS_CPUGROUP_STAT:
+            if ((!valid_user_pointer(arg1)) || (!valid_user_pointer(arg2))) {
+                exit(EXIT_BAD_PTR);
+            }
+            f->eax = cpugroup_stat(*((int *) arg1),
+                                   *((struct cpugroup_stat **) arg2));
+            break;
+
+        case SYS_UTHREAD_SPAWN:
+            if ((!valid_user_pointer(arg1)) || (!valid_user_pointer(arg2))) {
+                exit(EXIT_BAD_PTR);
+            }
+            f->eax = uthread_spawn(*((void **) arg1), *((void **) arg2));
+            break;
+
+        case SYS_UTHREAD_JOIN:
+            if ((!valid_user_pointer(arg1))) {
+                exit(EXIT_BAD_PTR);
+            }
+            f->eax = uthread_join(*((pid_t *) arg1));
+            break;
+
+        case SYS_UTHREAD_DETACH:
+            if ((!valid_user_pointer(arg1))) {
+                exit(EXIT_BAD_PTR);
+            }
+            f->eax = uthread_detach(*((pid_t *) arg1));
+            break;
+
+        case SYS_FUTEX_WAIT:
+            if ((!valid_user_pointer(arg1)) || (!valid_user_pointer(arg2))) {
+                exit(EXIT_BAD_PTR);
+            }
+            f->eax = futex_wait(*((int **) arg1), *((int *) arg2));
+            break;
+
+        case SYS_FUTEX_WAKE:
+            if ((!valid_user_pointer(arg1)) || (!valid_user_pointer(arg2))) {
+                exit(EXIT_BAD_PTR);
+            }
+            f->eax = futex_wake(*((int **) arg1), *((int *) arg2));
+            break;
+
         default:
             /* Yeah, we're not that nice */
             exit(EXIT_FAILURE);
     }
+
+    TRACE(TRACE_SYSCALL_EXIT, syscall_nr, f->eax);
 }
 
 
@@ -289,6 +403,15 @@ void exit(int status) {
     cur_thread = thread_current();
     pd = cur_thread->process_details;
 
+    /* A user thread leaves the process's files and mappings alone. */
+    if (pd->leader != cur_thread) {
+        cur_thread->exit_status = status;
+        thread_exit();
+    }
+
+    /* Let the process's other threads finish first. */
+    process_exit_threads();
+
     /* Unmap all open mmaps */
     while (pd->num_mapids_open > 0) {
         if (pd->open_mapids[mid]) {
@@ -353,18 +476,19 @@ int wait(pid_t pid) {
     /* Disable interrupts while accessing global state. */
     old_level = intr_disable();
     /* If child is running, down its semaphore hence blocking yourself */
-    for (e = list_begin(&all_list); e != list_end(&all_list); 
-         e = list_next(e)) {
-        iter = list_entry(e, struct thread, allelem);
-        if (iter->tid == tid) {
-            /* Check that it's our own child */
-            if (iter->process_details->parent_id != thread_current()->tid) {
-                return -1;
-            }
-            waitee = iter;
-            waitee_sema = waitee->waiter_sema;
-            break;
-        } 
+    iter = thread_lookup(tid);
+    if (iter != NULL) {
+        /* Check that it's our own child, and a process rather than a user
+         * thread, whose waiter_sema is never upped.
+         */
+        if (iter->process_details == NULL ||
+            iter->process_details->leader != iter ||
+            iter->process_details->parent_id != thread_current()->tid) {
+            intr_set_level(old_level);
+            return -1;
+        }
+        waitee = iter;
+        waitee_sema = waitee->waiter_sema;
     }
     intr_set_level(old_level);
 
@@ -681,9 +805,14 @@ mapid_t mmap(int fd, void *addr) {
     cur_thread = thread_current();
     pd = cur_thread->process_details;
 
-    /* Check that all addresses are available in supplemental page table. */
+    /* Check that all addresses are available in supplemental page table,
+     * and keep it locked until the mapping is in, so that another thread
+     * of the process cannot claim them meanwhile.
+     */
+    spt_lock(cur_thread);
     for (i = 0; i < num_pages; i++) {
         if (spt_present(cur_thread, addr + i * PGSIZE)) {
+            spt_unlock(cur_thread);
             lock_release(&filesys_lock);
             return MAP_FAILED;
         }
@@ -691,6 +820,7 @@ mapid_t mmap(int fd, void *addr) {
 
     /* Check that there are available mapids open */
     if (pd->num_mapids_open >= MAX_OPEN_FILES) {
+        spt_unlock(cur_thread);
         lock_release(&filesys_lock);
         return MAP_FAILED;
     }
@@ -712,6 +842,7 @@ mapid_t mmap(int fd, void *addr) {
         mapping = (struct vm_area_struct *)
                   calloc(1, sizeof(struct vm_area_struct));
         if (mapping == NULL) {
+            spt_unlock(cur_thread);
             exit(EXIT_FAILURE);
         }
 
@@ -727,6 +858,7 @@ mapid_t mmap(int fd, void *addr) {
                                  size - (PGSIZE * (num_pages - 1)) :
                                  PGSIZE;
         mapping->writable = true;
+        mapping->mmapped = true;
 
         /* Add to the supplemental page table */
         spt_add(cur_thread, mapping);
@@ -741,6 +873,7 @@ mapid_t mmap(int fd, void *addr) {
     }
 
     /* UNLOCK filesystem when done mapping and before returning. */
+    spt_unlock(cur_thread);
     lock_release(&filesys_lock);
 
     return mid;
@@ -807,3 +940,121 @@ void munmap(mapid_t mid) {
     }
 }
 #endif
+
+/* Copies the scheduler statistics of process pid into stats. Returns false
+ * if there is no such process.
+ */
+bool schedstat(pid_t pid, struct schedstat *stats) {
+    if (!valid_user_pointer(stats) ||
+        !valid_user_pointer((char *) stats + sizeof *stats - 1)) {
+        exit(EXIT_BAD_PTR);
+    }
+
+    return thread_get_schedstat(pid, stats);
+}
+
+/* Copies the statistics of up to max lock classes, most contended first,
+ * into stats. Returns the number of classes copied.
+ */
+int lockstat(struct lockstat *stats, int max) {
+    struct lockstat *buf;
+    int cnt;
+
+    if (max <= 0) {
+        return 0;
+    }
+    if (max > LOCKSTAT_CLASSES) {
+        max = LOCKSTAT_CLASSES;
+    }
+    if (!valid_user_range(stats, max * sizeof *stats)) {
+        exit(EXIT_BAD_PTR);
+    }
+
+    /* lockstat_top() runs with interrupts off, so it must not touch user
+     * memory, which may fault and sleep. */
+    buf = malloc(max * sizeof *buf);
+    if (buf == NULL) {
+        return 0;
+    }
+    cnt = lockstat_top(buf, max);
+    memcpy(stats, buf, cnt * sizeof *buf);
+    free(buf);
+    return cnt;
+}
+
+/* Puts the calling process in the earliest-deadline-first class, to run for
+ * runtime ticks by deadline ticks into every period of period ticks, or
+ * takes it out again if runtime is 0. Returns false if the parameters are
+ * invalid or the CPU time cannot be guaranteed.
+ */
+bool sched_setdeadline(unsigned runtime, unsigned deadline, unsigned period) {
+    return thread_set_edf(runtime, deadline, period);
+}
+
+/* Moves the calling process into a new CPU bandwidth group, which it and
+ * the processes it starts from now on may use for at most quota ticks in
+ * every period of period ticks. Returns the group's id, or -1 on failure.
+ */
+int cpugroup_create(unsigned quota, unsigned period) {
+    return cpugroup_new(quota, period);
+}
+
+/* Copies the usage of CPU bandwidth group group into stat. Returns false
+ * if there is no such group.
+ */
+bool cpugroup_stat(int group, struct cpugroup_stat *stat) {
+    if (!valid_user_pointer(stat) ||
+        !valid_user_pointer((char *) stat + sizeof *stat - 1)) {
+        exit(EXIT_BAD_PTR);
+    }
+
+    return cpugroup_get_stat(group, stat);
+}
+
+/* Starts a new thread in the calling process, sharing its address space
+ * and open files, that enters user code at eip with its stack pointer at
+ * esp. Returns the thread's id, or -1 on failure.
+ */
+pid_t uthread_spawn(void *eip, void *esp) {
+    if (!is_user_vaddr(eip) || !valid_user_pointer(esp)) {
+        return -1;
+    }
+
+    return process_thread_create(eip, esp);
+}
+
+/* Waits for thread tid of the calling process to exit and returns the
+ * status it passed to exit(), or -1 if it cannot be joined.
+ */
+int uthread_join(pid_t tid) {
+    return process_thread_join((tid_t) tid);
+}
+
+/* Lets thread tid of the calling process free its resources as soon as it
+ * exits, without being joined. Returns 0 on success, -1 if it cannot be
+ * joined.
+ */
+int uthread_detach(pid_t tid) {
+    return process_thread_detach((tid_t) tid);
+}
+
+/* Sleeps until woken by futex_wake() on addr, unless *addr no longer holds
+ * val. Returns 0 after sleeping, -1 otherwise.
+ */
+int futex_wait(int *addr, int val) {
+    if (!valid_user_pointer(addr) || (uintptr_t) addr % sizeof *addr != 0) {
+        exit(EXIT_BAD_PTR);
+    }
+
+    return futex_block(addr, val);
+}
+
+/* Wakes up to count threads sleeping on addr. Returns the number woken.
+ */
+int futex_wake(int *addr, int count) {
+    if (!valid_user_pointer(addr) || (uintptr_t) addr % sizeof *addr != 0) {
+        exit(EXIT_BAD_PTR);
+    }
+
+    return futex_wakeup(addr, count);
+}
@@ -1,6 +1,8 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <cpugroup.h>
+#include <lockstat.h>
 #include "threads/thread.h"
 
 /*! Typical return values from main() and arguments to exit(). */
@@ -89,4 +91,58 @@ mapid_t mmap (int fd, void *addr);
  * been unmapped. */
 void munmap (mapid_t mapping);
 
+/* Copies the scheduler statistics of process pid into stats. Returns false
+ * if there is no such process.
+ */
+bool schedstat(pid_t pid, struct schedstat *stats);
+
+/* Copies the statistics of up to max lock classes, most contended first,
+ * into stats. Returns the number of classes copied.
+ */
+int lockstat(struct lockstat *stats, int max);
+
+/* Puts the calling process in the earliest-deadline-first class, to run for
+ * runtime ticks by deadline ticks into every period of period ticks, or
+ * takes it out again if runtime is 0. Returns false if the parameters are
+ * invalid or the CPU time cannot be guaranteed.
+ */
+bool sched_setdeadline(unsigned runtime, unsigned deadline, unsigned period);
+
+/* Moves the calling process into a new CPU bandwidth group, which it and
+ * the processes it starts from now on may use for at most quota ticks in
+ * every period of period ticks. Returns the group's id, or -1 on failure.
+ */
+int cpugroup_create(unsigned quota, unsigned period);
+
+/* Copies the usage of CPU bandwidth group group into stat. Returns false
+ * if there is no such group.
+ */
+bool cpugroup_stat(int group, struct cpugroup_stat *stat);
+
+/* Starts a new thread in the calling process, sharing its address space
+ * and open files, that enters user code at eip with its stack pointer at
+ * esp. Returns the thread's id, or -1 on failure.
+ */
+pid_t uthread_spawn(void *eip, void *esp);
+
+/* Waits for thread tid of the calling process to exit and returns the
+ * status it passed to exit(), or -1 if it cannot be joined.
+ */
+int uthread_join(pid_t tid);
+
+/* Lets thread tid of the calling process free its resources as soon as it
+ * exits, without being joined. Returns 0 on success, -1 if it cannot be
+ * joined.
+ */
+int uthread_detach(pid_t tid);
+
+/* Sleeps until woken by futex_wake() on addr, unless *addr no longer holds
+ * val. Returns 0 after sleeping, -1 otherwise.
+ */
+int futex_wait(int *addr, int val);
+
+/* Wakes up to count threads sleeping on addr. Returns the number woken.
+ */
+int futex_wake(int *addr, int count);
+
 #endif /* userprog/syscall.h */
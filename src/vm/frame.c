@@ -1,14 +1,19 @@
 #include <debug.h>
 #include <hash.h>
+#include <string.h>
 #include "filesys/file.h"
 #include "vm/frame.h"
+#include "vm/pageout.h"
+#include "vm/replace.h"
 #include "vm/swap.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
+#include "userprog/process.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "threads/interrupt.h"
@@ -16,76 +21,264 @@
 struct lock frame_lock;
 struct lock filesys_lock;
 
-/* Evicts a frame from the frame table and returns the kernel virtual address
-   of that frame. */
-void *frame_evict(void) {
-    struct list_elem *e;
-    struct frame *frame;
-    struct vm_area_struct *vma; 
-    int bytes_written;
-    int fs_lock = 0;
-    enum intr_level old_level;
-    void *ret_kpage;
+/* Frames taken out of the frame table whose pages are still being written
+   to swap or to their file, linked through q_elem.  Protected by
+   frame_lock. */
+static struct list evicting_frames;
+
+/* Signaled, with frame_lock, when frames leave evicting_frames. */
+static struct condition evict_done;
+
+/* Initializes the frame table and the replacement policy picked with
+   -evict. */
+void frame_init(void) {
+    hash_init(&frame_table, &frame_hash_func, &frame_less, NULL);
+    list_init(&evicting_frames);
+    cond_init(&evict_done);
+    replace_policy->init();
+}
+
+/* Writes the dirty mmap'd page in FRAME back to its file.  Returns false,
+   without writing, if the file system is busy.  The thread holding
+   filesys_lock may itself be waiting, in frame_wait_evict(), for this very
+   page, so we must not block on it here. */
+static bool frame_write_back(struct frame *frame, struct vm_area_struct *vma) {
+    bool fs_lock = false;
+    off_t bytes_written;
+
+    if (!lock_held_by_current_thread(&filesys_lock)) {
+        if (!lock_try_acquire(&filesys_lock)) {
+            return false;
+        }
+        fs_lock = true;
+    }
+    bytes_written = file_write_at(vma->vm_file, frame->kpage,
+                                  vma->pg_read_bytes, vma->ofs);
+    if (fs_lock) {
+        lock_release(&filesys_lock);
+    }
+    ASSERT(bytes_written == (off_t) vma->pg_read_bytes);
+    return true;
+}
+
+/* Evicts up to CNT frames from the frame table and stores their kernel
+   virtual addresses in KPAGES.  Returns the number of frames evicted, which
+   is less than CNT only if the frame table runs out.  The replacement
+   policy picks the victims.
+
+   Only pages that cannot be re-created go to swap, and those of one batch
+   are written to adjacent swap slots with a single request.  A clean page
+   is dropped: it is re-read from its file or zero-filled on the next
+   fault.  A dirty mmap'd page is written back to its file.
+
+   The victims are picked and unmapped under frame_lock, but the lock is
+   dropped for the disk writes.  Meanwhile each page being written is
+   marked as evicting, and page_fault() waits in frame_wait_evict() only
+   if it faults on one of those. */
+size_t frame_evict_batch(void *kpages[], size_t cnt) {
+    struct frame *out_frames[SWAP_CLUSTER_MAX];
+    struct vm_area_struct *out_vmas[SWAP_CLUSTER_MAX];
+    bool written_back[SWAP_CLUSTER_MAX];
+    void *swap_kpages[SWAP_CLUSTER_MAX];
+    block_sector_t swap_sectors[SWAP_CLUSTER_MAX];
+    size_t evicted, out_cnt = 0, swap_cnt = 0, i;
+
+    ASSERT(cnt <= SWAP_CLUSTER_MAX);
 
     lock_acquire(&frame_lock);
-    ASSERT(list_size(&frame_queue) > 0);
+    for (evicted = 0; evicted < cnt && !hash_empty(&frame_table); evicted++) {
+        struct frame *frame = replace_policy->victim();
+        struct vm_area_struct *vma;
+        bool dirty;
+
+        replace_stats.evictions++;
 
-    while (1) {
-        e = list_pop_front(&frame_queue);
-        frame = list_entry(e, struct frame, q_elem);
-        /* Swap it out. First update the vm_area_struct for this page. */
+        /* First update the vm_area_struct for this page. */
         vma = spt_get_struct(frame->thread, frame->upage); 
+        /* The vm_area_struct for this upage MUST be present in the
+           supplemental page table for this thread. */
+        ASSERT(vma != NULL);
+        ASSERT(vma->pg_type != SWAP);
+        ASSERT(vma->kpage != NULL);
+
+        /* Unmap the page before looking at its dirty bit, so that the
+           process cannot write to it after we look.  The cleared PTE keeps
+           PTE_D. */
+        pagedir_clear_page(frame->thread->pagedir, vma->vm_start);
+        dirty = pagedir_is_dirty(frame->thread->pagedir, vma->vm_start);
+
+        vma->kpage = NULL;
+        kpages[evicted] = frame->kpage;
+        TRACE(TRACE_FRAME_EVICT, frame->upage, frame->thread->tid);
+        /* The policy has already forgotten the frame. */
+        hash_delete(&frame_table, &frame->elem);
 
-//         if (!pagedir_is_accessed(frame->thread->pagedir, frame->upage)) {
-            /* CHANGED TO FIFO IMPLEMENTATION. */
-        if (!vma->pinned) {
-            /* The frame has NOT been accessed. */
-            /* The vm_area_struct for this upage MUST be present in the
-               supplemental page table for this thread. */
-            ASSERT(vma != NULL);
-            ASSERT(vma->pg_type != SWAP);
-            ASSERT(vma->kpage != NULL);
-
-            if (vma->pg_type != SWAP) {
-                /* A stack page. */
-                vma->kpage = NULL;
-                vma->pg_type = SWAP;
-                vma->swap_ind = swap_add(frame->kpage);
+        if (!dirty && (vma->mmapped || vma->pg_type == FILE_SYS ||
+                       vma->pg_type == ZERO)) {
+            /* Unmodified since it was loaded; the next fault reloads it
+               from its file or zero-fills it. */
+            if (vma->mmapped) {
+                vma->pg_type = FILE_SYS;
             }
-            vma->kpage = NULL;
+            replace_stats.drops++;
+            free(frame);
+        }
+        else {
+            /* Written out below, once frame_lock is dropped. */
+            vma->evicting = true;
+            list_push_back(&evicting_frames, &frame->q_elem);
+            out_frames[out_cnt] = frame;
+            out_vmas[out_cnt++] = vma;
+        }
+    }
+    lock_release(&frame_lock);
+
+    if (out_cnt == 0) {
+        return evicted;
+    }
 
-            pagedir_clear_page(frame->thread->pagedir, vma->vm_start);
+    /* A dirty mmap'd page goes back to its file.  Anonymous data, and a
+       mmap'd page while the file system is busy, go to swap; the fault
+       handler marks the latter dirty again on swap-in. */
+    for (i = 0; i < out_cnt; i++) {
+        written_back[i] = out_vmas[i]->mmapped &&
+                          frame_write_back(out_frames[i], out_vmas[i]);
+        if (!written_back[i]) {
+            swap_kpages[swap_cnt++] = out_frames[i]->kpage;
+        }
+    }
+    if (swap_cnt > 0) {
+        swap_add_cluster(swap_kpages, swap_cnt, swap_sectors);
+    }
 
-            /* Save the kpage we return before freeing in 
-               frame_table_remove. */
-            ret_kpage = frame->kpage;
-            /* Remove the frame from the frame table. */
-            frame_table_remove(frame);
+    lock_acquire(&frame_lock);
+    for (i = 0, swap_cnt = 0; i < out_cnt; i++) {
+        struct vm_area_struct *vma = out_vmas[i];
 
-            
-            /* Return the now free kernel page. */
-            lock_release(&frame_lock);
-            return ret_kpage;
+        if (written_back[i]) {
+            vma->pg_type = FILE_SYS;
+            replace_stats.write_backs++;
         }
         else {
-            /* The frame HAS been accessed. */
-            /* Set its accessed bit to 0, then enqueue it. */
-            pagedir_set_accessed(frame->thread->pagedir, frame->upage, 0);
-            list_push_back(&frame_queue, &frame->q_elem);
+            vma->pg_type = SWAP;
+            vma->swap_ind = swap_sectors[swap_cnt++];
+            replace_stats.swap_outs++;
         }
+        vma->evicting = false;
+        list_remove(&out_frames[i]->q_elem);
+        free(out_frames[i]);
     }
+    cond_broadcast(&evict_done, &frame_lock);
     lock_release(&frame_lock);
+    return evicted;
 }
 
-/* Remove the frame from the frame table. */
+/* Evicts a frame from the frame table and returns the kernel virtual address
+   of that frame. */
+void *frame_evict(void) {
+    void *kpage;
+
+    if (frame_evict_batch(&kpage, 1) != 1) {
+        PANIC("No frame to evict.");
+    }
+    return kpage;
+}
+
+/* Waits until the page described by VMA is no longer being written out.
+   A page being evicted is unmapped before its vm_area_struct is up to
+   date, so page_fault() calls this before looking at the vm_area_struct
+   of a page that is not present. */
+void frame_wait_evict(struct vm_area_struct *vma) {
+    lock_acquire(&frame_lock);
+    while (vma->evicting) {
+        cond_wait(&evict_done, &frame_lock);
+    }
+    lock_release(&frame_lock);
+}
+
+/* Returns true if a page of LEADER's process is being written out.  Must
+   be called with frame_lock held. */
+static bool frame_evicting_from(struct thread *leader) {
+    struct list_elem *e;
+
+    for (e = list_begin(&evicting_frames); e != list_end(&evicting_frames);
+         e = list_next(e)) {
+        if (list_entry(e, struct frame, q_elem)->thread == leader) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Obtains a frame for a user page, with FLAGS as for palloc_get_page().
+   Takes a free page from the user pool if there is one, which leaves the
+   work of refilling the pool to the page-out daemon.  Only when the pool
+   is empty does the caller evict a frame itself. */
+void *frame_alloc(enum palloc_flags flags) {
+    void *kpage = palloc_get_page(flags | PAL_USER);
+
+    if (kpage == NULL) {
+        pageout_stats.direct_evictions++;
+        kpage = frame_evict();
+        if (flags & PAL_ZERO) {
+            memset(kpage, 0, PGSIZE);
+        }
+    }
+    pageout_check();
+    return kpage;
+}
+
+/* Remove the frame with FRAME's kpage from the frame table and from the
+   replacement policy. */
 void frame_table_remove(struct frame *frame) {
     struct frame *f;
     struct hash_elem *entry;
+    bool held = lock_held_by_current_thread(&frame_lock);
+
+    if (!held)
+        lock_acquire(&frame_lock);
     entry = hash_delete(&frame_table, &frame->elem);
     if (entry != NULL) {
         f = hash_entry(entry, struct frame, elem);
+        replace_policy->remove(f);
         free(f);
     }
+    if (!held)
+        lock_release(&frame_lock);
+}
+
+/* Removes every frame of T's process from the frame table and from the
+   replacement policy, without freeing the kernel pages.  Called as the
+   process exits, before its page directory, and the pages it maps, are
+   destroyed.  Waits first for the process's pages that are being written
+   out, whose vm_area_structs eviction is still going to update. */
+void frame_remove_thread(struct thread *t) {
+    struct thread *leader = process_leader(t);
+    struct list dead;
+    struct hash_iterator i;
+
+    /* The hash table cannot be changed while we iterate over it, so
+       collect the frames on DEAD through their policy list elements. */
+    list_init(&dead);
+    lock_acquire(&frame_lock);
+    while (frame_evicting_from(leader)) {
+        cond_wait(&evict_done, &frame_lock);
+    }
+    hash_first(&i, &frame_table);
+    while (hash_next(&i)) {
+        struct frame *frame = hash_entry(hash_cur(&i), struct frame, elem);
+        if (frame->thread == leader) {
+            replace_policy->remove(frame);
+            list_push_back(&dead, &frame->q_elem);
+        }
+    }
+    while (!list_empty(&dead)) {
+        struct frame *frame = list_entry(list_pop_front(&dead),
+                                         struct frame, q_elem);
+        hash_delete(&frame_table, &frame->elem);
+        free(frame);
+    }
+    lock_release(&frame_lock);
 }
 
 /* Add a frame to the frame table. Keep track of the upage, kpage, and the 
@@ -98,14 +291,14 @@ void frame_add(struct thread *t, void *upage, void *kpage) {
 
     frame = (struct frame *) malloc(sizeof(struct frame));
     /* Store the thread/process that owns this upage. */
-    frame->thread = t;
+    frame->thread = process_leader(t);
     frame->upage = upage; 
     frame->kpage = kpage;
 
     /* The frame table remains ordered by the physical address of the frame. */
     lock_acquire(&frame_lock);
     hash_insert(&frame_table, &frame->elem);
-    list_push_back(&frame_queue, &frame->q_elem);
+    replace_policy->add(frame);
     lock_release(&frame_lock);
 }
 
@@ -3,8 +3,10 @@
 
 #include <hash.h>
 #include <list.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#include "threads/palloc.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
 #include "vm/page.h"
@@ -12,9 +14,6 @@
 /*! Store the frame table as a list, sorted by frame number. */
 struct hash frame_table;
 
-/*! The frame queue -- used for implementing a second chance policy. */
-struct list frame_queue;
-
 /*! Frame struct used by the frame table to keep track of which frames are
     free and which frames are allocated. */
 struct frame {
@@ -29,11 +28,20 @@ struct frame {
     /* The list_elem in the frame table list. */
     struct hash_elem elem;
 
-    /* The list_elem for the frame queue for eviction policy. */
+    /* The list_elem in the replacement policy's lists (vm/replace.c). */
     struct list_elem q_elem;
+    /* The policy list Q_ELEM is on, for policies with several lists. */
+    struct list *queue;
+    /* Timer tick at which the page was last seen referenced. */
+    int64_t last_use;
 };
 
+void frame_init(void);
+void *frame_alloc(enum palloc_flags flags);
 void *frame_evict(void);
+size_t frame_evict_batch(void *kpages[], size_t cnt);
+void frame_wait_evict(struct vm_area_struct *vma);
+void frame_remove_thread(struct thread *t);
 void frame_table_remove(struct frame *frame);
 void frame_add(struct thread *t, void *upage, void *kpage);
 bool frame_less(const struct hash_elem *elem1, const struct hash_elem *elem2, 
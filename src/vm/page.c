@@ -1,20 +1,63 @@
 #include <debug.h>
 #include "threads/malloc.h"
 #include "threads/thread.h"
+#include "userprog/process.h"
 #include "vm/page.h"
 #include "vm/frame.h"
 
 /* Procedures for accessing and manipulating the supplemental page table. */
 
+/* User threads share the supplemental page table of their process leader. */
+static struct hash *spt_of(struct thread *t) {
+    return &process_leader(t)->spt;
+}
+
+/* Locks the supplemental page table T uses, so that several operations on
+   it are atomic with respect to the other threads of T's process.  The
+   functions below also lock it themselves when the caller has not.  Must
+   not be held while taking frame_lock, which eviction holds while it
+   picks and looks up pages. */
+void spt_lock(struct thread *t) {
+    lock_acquire(&process_leader(t)->spt_lock);
+}
+
+/* Unlocks the supplemental page table T uses. */
+void spt_unlock(struct thread *t) {
+    lock_release(&process_leader(t)->spt_lock);
+}
+
+/* Locks T's supplemental page table unless the current thread already
+   holds it.  Returns true if it was taken here. */
+static bool spt_enter(struct thread *t) {
+    struct lock *lock = &process_leader(t)->spt_lock;
+
+    if (lock_held_by_current_thread(lock)) {
+        return false;
+    }
+    lock_acquire(lock);
+    return true;
+}
+
+/* Undoes spt_enter(), which returned TAKEN. */
+static void spt_leave(struct thread *t, bool taken) {
+    if (taken) {
+        spt_unlock(t);
+    }
+}
+
 /* Add a vm_area_struct to the thread's supplemental page table. */
 void spt_add(struct thread *t, struct vm_area_struct *vm_area) {
+    bool taken;
+
     /* Assert validity of start and end addresses. */
     ASSERT(vm_area->vm_start < vm_area->vm_end);
 
     /* PANIC if overlapping memory when inserting into table. */
-    if (hash_insert(&t->spt, &vm_area->elem) != NULL) {
+    taken = spt_enter(t);
+    if (hash_insert(spt_of(t), &vm_area->elem) != NULL) {
         PANIC("Overlapping vm_area_structs detected.");
     }
+    spt_leave(t, taken);
 }
 
 /* Returns the vm_area_struct in thread T corresponding to UPAGE. If not 
@@ -23,16 +66,23 @@ struct vm_area_struct *spt_get_struct(struct thread *t, void *upage) {
     struct hash_elem *h_elem;
     struct vm_area_struct vma;
 
+    bool taken;
+
     vma.vm_start = upage;
     
-    h_elem = hash_find(&t->spt, &vma.elem);
+    taken = spt_enter(t);
+    h_elem = hash_find(spt_of(t), &vma.elem);
+    spt_leave(t, taken);
     return h_elem == NULL ? NULL : 
            hash_entry(h_elem, struct vm_area_struct, elem);
 }
 
 /* Removes a vm_area_struct from its supplemental page table. */
 void spt_remove(struct thread *t, struct vm_area_struct *vm_area) {
-    hash_delete(&t->spt, &vm_area->elem);
+    bool taken = spt_enter(t);
+
+    hash_delete(spt_of(t), &vm_area->elem);
+    spt_leave(t, taken);
     free(vm_area);
 }
 
@@ -40,8 +90,13 @@ void spt_remove(struct thread *t, struct vm_area_struct *vm_area) {
    table for this thread, FALSE otherwise. */
 bool spt_present(struct thread *t, void *upage) {
     struct vm_area_struct vma;
+    bool taken, present;
+
     vma.vm_start = upage;
-    return hash_find(&t->spt, &vma.elem) != NULL;
+    taken = spt_enter(t);
+    present = hash_find(spt_of(t), &vma.elem) != NULL;
+    spt_leave(t, taken);
+    return present;
 }
 
 unsigned spt_hash_func(const struct hash_elem *element, void *aux UNUSED) {
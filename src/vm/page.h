@@ -33,6 +33,13 @@ struct vm_area_struct {
     /* Is this area pinned */
     bool pinned;
 
+    /* Is the page being written out by eviction (see frame_evict_batch()).
+       Protected by frame_lock. */
+    bool evicting;
+
+    /* Is this area a mmap'd file, written back to VM_FILE on eviction. */
+    bool mmapped;
+
     /* Pointer to the file object of the mapped file, if any. */
     struct file *vm_file;
 
@@ -50,6 +57,8 @@ struct vm_area_struct {
     struct hash_elem elem;
 };
 
+void spt_lock(struct thread *t);
+void spt_unlock(struct thread *t);
 void spt_add(struct thread *t, struct vm_area_struct *vm_area);  
 struct vm_area_struct *spt_get_struct(struct thread *t, void *upage);
 void spt_remove(struct thread *t, struct vm_area_struct *vm_area);
@@ -0,0 +1,99 @@
+#include <debug.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "vm/frame.h"
+#include "vm/pageout.h"
+#include "vm/swap.h"
+
+/* The page-out daemon keeps a reserve of free user frames, so that page
+   faults rarely have to evict a frame, and wait for its disk I/O,
+   themselves.  It is woken when the number of free frames drops below
+   pageout_low, and evicts frames in batches until there are pageout_high
+   free. */
+
+struct pageout_stats pageout_stats;
+
+/* Free frame watermarks, set from the size of the user pool. */
+static size_t pageout_low, pageout_high;
+
+/* Up'd to wake the daemon. */
+static struct semaphore pageout_wakeup;
+
+/* True while the daemon is awake, so that faults do not keep waking it. */
+static bool pageout_running;
+
+/* False until pageout_init() has started the daemon. */
+static bool pageout_started;
+
+static void pageout_daemon(void *aux UNUSED);
+
+/* Sets the watermarks and starts the page-out daemon.  Must be called
+   after frame_init() and swap_init(). */
+void pageout_init(void) {
+    size_t user_pages = palloc_user_page_cnt();
+
+    pageout_low = user_pages / 16;
+    if (pageout_low < SWAP_CLUSTER_MAX) {
+        pageout_low = SWAP_CLUSTER_MAX;
+    }
+    pageout_high = pageout_low * 2;
+    if (pageout_high > user_pages / 2) {
+        /* Too small a pool to keep a reserve in; leave eviction to the
+           faulting threads. */
+        return;
+    }
+
+    sema_init(&pageout_wakeup, 0);
+    if (thread_create("pageout", PRI_DEFAULT, pageout_daemon, NULL)
+        == TID_ERROR) {
+        PANIC("Unable to start the page-out daemon.");
+    }
+    pageout_started = true;
+}
+
+/* Wakes the page-out daemon if free user frames have run low.  Called
+   after taking a frame from the user pool. */
+void pageout_check(void) {
+    if (pageout_started && !pageout_running &&
+        palloc_user_free_cnt() < pageout_low) {
+        pageout_running = true;
+        sema_up(&pageout_wakeup);
+    }
+}
+
+void pageout_print_stats(void) {
+    printf("Page-out: %llu wakeups, %llu frames freed, "
+           "%llu direct evictions\n", pageout_stats.wakeups,
+           pageout_stats.freed, pageout_stats.direct_evictions);
+}
+
+/* Evicts frames, SWAP_CLUSTER_MAX at a time, whenever woken, until the
+   high watermark is reached or there is nothing left to evict. */
+static void pageout_daemon(void *aux UNUSED) {
+    void *kpages[SWAP_CLUSTER_MAX];
+    size_t free_cnt, cnt, i;
+
+    for (;;) {
+        sema_down(&pageout_wakeup);
+        pageout_stats.wakeups++;
+
+        while ((free_cnt = palloc_user_free_cnt()) < pageout_high) {
+            cnt = pageout_high - free_cnt;
+            if (cnt > SWAP_CLUSTER_MAX) {
+                cnt = SWAP_CLUSTER_MAX;
+            }
+            cnt = frame_evict_batch(kpages, cnt);
+            if (cnt == 0) {
+                break;
+            }
+            for (i = 0; i < cnt; i++) {
+                palloc_free_page(kpages[i]);
+            }
+            pageout_stats.freed += cnt;
+        }
+        pageout_running = false;
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef PAGEOUT_H
+#define PAGEOUT_H
+
+/*! Page-out daemon statistics, printed at shutdown. */
+struct pageout_stats {
+    /* Times the daemon was woken. */
+    unsigned long long wakeups;
+    /* Frames the daemon evicted and returned to the user pool. */
+    unsigned long long freed;
+    /* Frames evicted by faulting threads because the pool was empty. */
+    unsigned long long direct_evictions;
+};
+
+extern struct pageout_stats pageout_stats;
+
+void pageout_init(void);
+void pageout_check(void);
+void pageout_print_stats(void);
+
+#endif
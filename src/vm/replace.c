@@ -0,0 +1,361 @@
+#include <debug.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/replace.h"
+
+static const struct replace_policy fifo_policy, clock_policy, wsclock_policy,
+                                   twoq_policy;
+
+/*! Policies selectable with -evict=NAME.  The first one is the default. */
+static const struct replace_policy *const policies[] = {
+    &clock_policy, &fifo_policy, &wsclock_policy, &twoq_policy, NULL
+};
+
+const struct replace_policy *replace_policy = &clock_policy;
+struct replace_stats replace_stats;
+
+/*! Makes the policy called NAME the one frame_evict() uses.  Returns false
+    if there is no such policy.  Must be called before frame_init(). */
+bool replace_select(const char *name) {
+    const struct replace_policy *const *p;
+
+    for (p = policies; *p != NULL; p++) {
+        if (!strcmp((*p)->name, name)) {
+            replace_policy = *p;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*! Returns true if FRAME's page may not be evicted right now.  The page
+    table lock orders after frame_lock, which we hold. */
+bool replace_pinned(struct frame *frame) {
+    struct vm_area_struct *vma;
+    bool pinned;
+
+    spt_lock(frame->thread);
+    vma = spt_get_struct(frame->thread, frame->upage);
+    pinned = vma == NULL || vma->pinned;
+    spt_unlock(frame->thread);
+    return pinned;
+}
+
+/*! Returns true if FRAME's page was accessed since the last call, and
+    clears its accessed bit. */
+bool replace_referenced(struct frame *frame) {
+    uint32_t *pd = frame->thread->pagedir;
+
+    if (!pagedir_is_accessed(pd, frame->upage))
+        return false;
+    pagedir_set_accessed(pd, frame->upage, false);
+    return true;
+}
+
+/*! Returns true if FRAME's page was written through its user mapping. */
+bool replace_dirty(struct frame *frame) {
+    return pagedir_is_dirty(frame->thread->pagedir, frame->upage);
+}
+
+void replace_print_stats(void) {
+    printf("Frames: %s eviction, %llu evictions, %llu scans, %llu hits, "
+           "%llu ghost hits\n", replace_policy->name, replace_stats.evictions,
+           replace_stats.scans, replace_stats.hits, replace_stats.ghost_hits);
+    printf("Evicted pages: %llu dropped, %llu written back, %llu swapped\n",
+           replace_stats.drops, replace_stats.write_backs,
+           replace_stats.swap_outs);
+}
+
+/* FIFO: evict the frame that was filled first, skipping pinned ones. */
+
+static struct list fifo_queue;
+
+static void fifo_init(void) {
+    list_init(&fifo_queue);
+}
+
+static void fifo_add(struct frame *frame) {
+    list_push_back(&fifo_queue, &frame->q_elem);
+}
+
+static void fifo_remove(struct frame *frame) {
+    list_remove(&frame->q_elem);
+}
+
+static struct frame *fifo_victim(void) {
+    struct frame *frame;
+
+    ASSERT(!list_empty(&fifo_queue));
+    for (;;) {
+        frame = list_entry(list_pop_front(&fifo_queue), struct frame, q_elem);
+        replace_stats.scans++;
+        if (!replace_pinned(frame))
+            return frame;
+        list_push_back(&fifo_queue, &frame->q_elem);
+    }
+}
+
+static const struct replace_policy fifo_policy = {
+    "fifo", fifo_init, fifo_add, fifo_remove, fifo_victim
+};
+
+/* Clock: the frames form a ring swept by a hand.  A frame whose accessed
+   bit is set gets its bit cleared and a second chance; the first frame
+   found with the bit clear is evicted.  WSClock shares the ring. */
+
+static struct list clock_ring;
+
+/*! Next frame the hand will examine.  list_end() stands for the start of
+    the ring. */
+static struct list_elem *clock_hand;
+
+static void clock_init(void) {
+    list_init(&clock_ring);
+    clock_hand = list_end(&clock_ring);
+}
+
+/*! New frames go just behind the hand, so they are examined last. */
+static void clock_add(struct frame *frame) {
+    list_insert(clock_hand, &frame->q_elem);
+}
+
+static void clock_remove(struct frame *frame) {
+    if (clock_hand == &frame->q_elem)
+        clock_hand = list_next(clock_hand);
+    list_remove(&frame->q_elem);
+}
+
+/*! Returns the frame under the hand and moves the hand past it. */
+static struct frame *clock_advance(void) {
+    struct frame *frame;
+
+    ASSERT(!list_empty(&clock_ring));
+    if (clock_hand == list_end(&clock_ring))
+        clock_hand = list_begin(&clock_ring);
+    frame = list_entry(clock_hand, struct frame, q_elem);
+    clock_hand = list_next(clock_hand);
+    replace_stats.scans++;
+    return frame;
+}
+
+static struct frame *clock_victim(void) {
+    struct frame *frame;
+
+    for (;;) {
+        frame = clock_advance();
+        if (replace_pinned(frame))
+            continue;
+        if (replace_referenced(frame)) {
+            replace_stats.hits++;
+            continue;
+        }
+        clock_remove(frame);
+        return frame;
+    }
+}
+
+static const struct replace_policy clock_policy = {
+    "clock", clock_init, clock_add, clock_remove, clock_victim
+};
+
+/* WSClock: like clock, but each frame also remembers when it was last
+   seen referenced.  A frame unreferenced for longer than WSCLOCK_TAU ticks
+   is outside the working set; clean ones are evicted at once, since they
+   are the cheapest to give up.  If one sweep finds no such frame, the
+   oldest unreferenced frame is evicted instead. */
+
+/*! Working set window, in timer ticks. */
+#define WSCLOCK_TAU (TIMER_FREQ / 4)
+
+static void wsclock_add(struct frame *frame) {
+    frame->last_use = timer_ticks();
+    clock_add(frame);
+}
+
+static struct frame *wsclock_victim(void) {
+    int64_t now = timer_ticks();
+
+    for (;;) {
+        struct frame *oldest = NULL;
+        size_t n = list_size(&clock_ring);
+
+        while (n-- > 0) {
+            struct frame *frame = clock_advance();
+
+            if (replace_pinned(frame))
+                continue;
+            if (replace_referenced(frame)) {
+                replace_stats.hits++;
+                frame->last_use = now;
+                continue;
+            }
+            if (now - frame->last_use > WSCLOCK_TAU && !replace_dirty(frame)) {
+                clock_remove(frame);
+                return frame;
+            }
+            if (oldest == NULL || frame->last_use < oldest->last_use)
+                oldest = frame;
+        }
+        if (oldest != NULL) {
+            clock_remove(oldest);
+            return oldest;
+        }
+    }
+}
+
+static const struct replace_policy wsclock_policy = {
+    "wsclock", clock_init, wsclock_add, clock_remove, wsclock_victim
+};
+
+/* 2Q: pages faulted in for the first time enter A1in, a FIFO holding
+   about a quarter of the frames, so a one-pass scan cannot flush the rest
+   of memory.  Pages evicted from A1in are remembered in the ghost ring
+   A1out; a page faulted in again while still remembered has proven itself
+   and joins Am, which is managed by clock. */
+
+static struct list twoq_a1in;
+static struct list twoq_am;
+static struct list_elem *twoq_hand;
+static size_t twoq_a1in_cnt, twoq_am_cnt;
+
+/*! Number of recently evicted pages A1out remembers. */
+#define TWOQ_GHOST_CNT 512
+
+/*! A page remembered in A1out. */
+struct twoq_ghost {
+    tid_t tid;
+    void *upage;
+};
+
+static struct twoq_ghost twoq_a1out[TWOQ_GHOST_CNT];
+static size_t twoq_a1out_next;
+
+static void twoq_init(void) {
+    size_t i;
+
+    list_init(&twoq_a1in);
+    list_init(&twoq_am);
+    twoq_hand = list_end(&twoq_am);
+    for (i = 0; i < TWOQ_GHOST_CNT; i++)
+        twoq_a1out[i].tid = TID_ERROR;
+}
+
+/*! Remembers FRAME's page in A1out, forgetting the oldest entry. */
+static void twoq_ghost_add(struct frame *frame) {
+    struct twoq_ghost *g = &twoq_a1out[twoq_a1out_next];
+
+    g->tid = frame->thread->tid;
+    g->upage = frame->upage;
+    twoq_a1out_next = (twoq_a1out_next + 1) % TWOQ_GHOST_CNT;
+}
+
+/*! If FRAME's page is remembered in A1out, forgets it and returns true. */
+static bool twoq_ghost_take(struct frame *frame) {
+    tid_t tid = frame->thread->tid;
+    size_t i;
+
+    for (i = 0; i < TWOQ_GHOST_CNT; i++) {
+        struct twoq_ghost *g = &twoq_a1out[i];
+        if (g->tid == tid && g->upage == frame->upage) {
+            g->tid = TID_ERROR;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void twoq_add(struct frame *frame) {
+    if (twoq_ghost_take(frame)) {
+        replace_stats.ghost_hits++;
+        frame->queue = &twoq_am;
+        list_insert(twoq_hand, &frame->q_elem);
+        twoq_am_cnt++;
+    }
+    else {
+        frame->queue = &twoq_a1in;
+        list_push_back(&twoq_a1in, &frame->q_elem);
+        twoq_a1in_cnt++;
+    }
+}
+
+static void twoq_remove(struct frame *frame) {
+    if (frame->queue == &twoq_am) {
+        if (twoq_hand == &frame->q_elem)
+            twoq_hand = list_next(twoq_hand);
+        twoq_am_cnt--;
+    }
+    else
+        twoq_a1in_cnt--;
+    list_remove(&frame->q_elem);
+}
+
+/*! Returns the first unpinned frame in A1in, or a null pointer. */
+static struct frame *twoq_a1in_victim(void) {
+    struct list_elem *e;
+
+    for (e = list_begin(&twoq_a1in); e != list_end(&twoq_a1in);
+         e = list_next(e)) {
+        struct frame *frame = list_entry(e, struct frame, q_elem);
+
+        replace_stats.scans++;
+        if (!replace_pinned(frame)) {
+            twoq_remove(frame);
+            twoq_ghost_add(frame);
+            return frame;
+        }
+    }
+    return NULL;
+}
+
+/*! Sweeps Am once with the clock algorithm.  Returns the victim, or a null
+    pointer if every frame was pinned or referenced. */
+static struct frame *twoq_am_victim(void) {
+    size_t n = twoq_am_cnt;
+
+    while (n-- > 0) {
+        struct frame *frame;
+
+        if (twoq_hand == list_end(&twoq_am))
+            twoq_hand = list_begin(&twoq_am);
+        frame = list_entry(twoq_hand, struct frame, q_elem);
+        twoq_hand = list_next(twoq_hand);
+        replace_stats.scans++;
+
+        if (replace_pinned(frame))
+            continue;
+        if (replace_referenced(frame)) {
+            replace_stats.hits++;
+            continue;
+        }
+        twoq_remove(frame);
+        return frame;
+    }
+    return NULL;
+}
+
+static struct frame *twoq_victim(void) {
+    ASSERT(twoq_a1in_cnt + twoq_am_cnt > 0);
+    for (;;) {
+        size_t kin = (twoq_a1in_cnt + twoq_am_cnt) / 4;
+        struct frame *frame = NULL;
+
+        if (twoq_a1in_cnt > kin || twoq_am_cnt == 0)
+            frame = twoq_a1in_victim();
+        if (frame == NULL)
+            frame = twoq_am_victim();
+        if (frame == NULL)
+            frame = twoq_a1in_victim();
+        if (frame != NULL)
+            return frame;
+    }
+}
+
+static const struct replace_policy twoq_policy = {
+    "2q", twoq_init, twoq_add, twoq_remove, twoq_victim
+};
@@ -0,0 +1,51 @@
+#ifndef REPLACE_H
+#define REPLACE_H
+
+#include <stdbool.h>
+
+struct frame;
+
+/*! A page replacement policy.  The policy keeps its own bookkeeping of
+    the frames in the frame table and decides which one frame_evict()
+    gives up next.  Every hook is called with frame_lock held. */
+struct replace_policy {
+    /* Name used to select the policy with -evict=NAME. */
+    const char *name;
+    /* Sets up the policy's lists.  Called once from frame_init(). */
+    void (*init)(void);
+    /* FRAME has just been added to the frame table. */
+    void (*add)(struct frame *frame);
+    /* FRAME is being removed from the frame table without eviction. */
+    void (*remove)(struct frame *frame);
+    /* Picks an unpinned frame, forgets it, and returns it. */
+    struct frame *(*victim)(void);
+};
+
+/*! Counters for the policy in use, printed at shutdown. */
+struct replace_stats {
+    /* Frames handed out by victim(). */
+    unsigned long long evictions;
+    /* Frames examined while looking for victims. */
+    unsigned long long scans;
+    /* Frames spared because they had been referenced. */
+    unsigned long long hits;
+    /* Pages faulted back in soon after being evicted (2Q only). */
+    unsigned long long ghost_hits;
+    /* Evicted pages that were clean and simply dropped. */
+    unsigned long long drops;
+    /* Evicted dirty mmap'd pages written back to their files. */
+    unsigned long long write_backs;
+    /* Evicted pages written to swap. */
+    unsigned long long swap_outs;
+};
+
+extern const struct replace_policy *replace_policy;
+extern struct replace_stats replace_stats;
+
+bool replace_select(const char *name);
+bool replace_pinned(struct frame *frame);
+bool replace_referenced(struct frame *frame);
+bool replace_dirty(struct frame *frame);
+void replace_print_stats(void);
+
+#endif
@@ -1,14 +1,21 @@
+#include <bitmap.h>
 #include <debug.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include "vm/swap.h"
 #include "devices/block.h"
-#include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 
-struct block *swap_device;
+/* Swap slots in use, one bit per page-sized slot of the swap device. */
+static struct bitmap *swap_slots;
 
-/* Lock for accessing the global swap table. */
+/* Next-fit cursor: the slot just past the run handed out last, so that
+   consecutive evictions land in adjacent slots. */
+static size_t swap_cursor;
+
+/* Lock for swap_slots and swap_cursor. */
 struct lock swap_lock;
 
 /*! Initialize the swap device. */
@@ -19,90 +26,97 @@ void swap_init(void) {
         PANIC("No swap device found, can't initialize the swap partition.");
     }
 
-    /* Initialize the swap hash table. */
-    if (!hash_init(&swap_table, &swap_hash_func, &swap_hash_less, NULL)) {
-        PANIC("Unable to initialize swap partition hash table.");
+    /* Initialize the swap slot bitmap. */
+    swap_slots = bitmap_create(block_size(swap_device) / SECTORS_PER_PAGE);
+    if (swap_slots == NULL) {
+        PANIC("Unable to initialize swap slot bitmap.");
+    }
+}
+
+/* Reserves CNT adjacent free slots, searching from the cursor and then
+   wrapping around to the start of the device.  Returns the first slot, or
+   BITMAP_ERROR if there is no such run.  Must be called with swap_lock
+   held. */
+static size_t swap_alloc(size_t cnt) {
+    size_t slot;
+
+    slot = bitmap_scan_and_flip(swap_slots, swap_cursor, cnt, false);
+    if (slot == BITMAP_ERROR && swap_cursor != 0) {
+        slot = bitmap_scan_and_flip(swap_slots, 0, cnt, false);
     }
+    if (slot != BITMAP_ERROR) {
+        swap_cursor = (slot + cnt) % bitmap_size(swap_slots);
+    }
+    return slot;
 }
 
-/* Store the page at KPAGE into the swap, and record this in the swap table. */
+/* Store the page at KPAGE into the swap, and return the first sector it
+   was written to. */
 block_sector_t swap_add(void *kpage) {
-    struct swap_slot ss_iter;
-    struct swap_slot *ss;
-    block_sector_t i, j, swap_size;
-    bool found_space = false;
+    block_sector_t sector;
+
+    swap_add_cluster(&kpage, 1, &sector);
+    return sector;
+}
 
-    swap_size = block_size(swap_device);
+/* Store the CNT pages at KPAGES[0] through KPAGES[CNT - 1] into the swap,
+   and set SECTORS[I] to the first sector KPAGES[I] was written to.  The
+   pages go to adjacent slots and are written with a single request when
+   the swap partition has a long enough free run; otherwise the cluster is
+   split. */
+void swap_add_cluster(void *const kpages[], size_t cnt,
+                      block_sector_t sectors[]) {
+    const void *buffers[SWAP_CLUSTER_MAX * SECTORS_PER_PAGE];
+    size_t slot, i, j;
+
+    ASSERT(cnt > 0 && cnt <= SWAP_CLUSTER_MAX);
 
-    /* Insert into the swap table. */
     lock_acquire(&swap_lock);
+    slot = swap_alloc(cnt);
+    lock_release(&swap_lock);
 
-    /* Find the first free sector within the swap partition to store the KPAGE
-       contents. */
-    for (i = 0; i < swap_size; i += SECTORS_PER_PAGE) {
-        ss_iter.sector_ind = i;
-        if (hash_find(&swap_table, &ss_iter.hash_elem) == NULL) {
-             found_space = true;
-             /* Write to sectors i to i + SECTORS_PER_PAGE - 1, since each 
-                sector is only 512 bytes in size. */
-             for (j = 0; j < SECTORS_PER_PAGE; j++) {
-                 block_write(swap_device, i + j, 
-                             kpage + BLOCK_SECTOR_SIZE * j); 
-             }
-             break;
+    if (slot == BITMAP_ERROR) {
+        if (cnt == 1) {
+            PANIC("Swap partition full.");
         }
-    }
-    if (!found_space) {
-        PANIC("Swap partition full.");
+        swap_add_cluster(kpages, cnt / 2, sectors);
+        swap_add_cluster(kpages + cnt / 2, cnt - cnt / 2, sectors + cnt / 2);
+        return;
     }
 
-    /* Create a swap_slot entry. */
-    ss = (struct swap_slot *) malloc(sizeof(struct swap_slot));
-    ss->sector_ind = i;
-    if (hash_insert(&swap_table, &ss->hash_elem) != NULL) {
-        PANIC("Overwriting swap partition write detected.");
+    /* The slots are ours now, so the write needs no lock. */
+    for (i = 0; i < cnt; i++) {
+        sectors[i] = (slot + i) * SECTORS_PER_PAGE;
+        TRACE(TRACE_SWAP_ADD, kpages[i], sectors[i]);
+        for (j = 0; j < SECTORS_PER_PAGE; j++) {
+            buffers[i * SECTORS_PER_PAGE + j] =
+                (const uint8_t *) kpages[i] + BLOCK_SECTOR_SIZE * j;
+        }
     }
-    lock_release(&swap_lock);
-    return i; 
+    block_write_multi(swap_device, sectors[0], cnt * SECTORS_PER_PAGE,
+                      buffers);
 }
 
 /* Remove the swapped in page at SECTOR, and write it to BUFFER.
-   If BUFFER is NULL, remove from swap table and do NOT perform write. */
+   If BUFFER is NULL, free the slot and do NOT perform the read. */
 void swap_remove(block_sector_t sector, void *buffer) {
-    struct hash_elem *e;
-    struct swap_slot ss;
+    size_t slot = sector / SECTORS_PER_PAGE;
+    void *buffers[SECTORS_PER_PAGE];
     block_sector_t i;
+
+    ASSERT(sector % SECTORS_PER_PAGE == 0);
     if (buffer != NULL) {
         for (i = 0; i < SECTORS_PER_PAGE; i++) {
-            block_read(swap_device, sector + i, buffer + BLOCK_SECTOR_SIZE * i);
+            buffers[i] = (uint8_t *) buffer + BLOCK_SECTOR_SIZE * i;
         }
+        block_read_multi(swap_device, sector, SECTORS_PER_PAGE, buffers);
     }
-    /* Remove the struct swap_slot from the swap table. */ 
-    ss.sector_ind = sector; 
+
+    /* Release the slot. */
     lock_acquire(&swap_lock);
-    e = hash_delete(&swap_table, &ss.hash_elem);
-    if (e == NULL) {
+    if (!bitmap_test(swap_slots, slot)) {
         PANIC("Attempting to release a free slot in swap.");
     }
+    bitmap_reset(swap_slots, slot);
     lock_release(&swap_lock);
-    free(hash_entry(e, struct swap_slot, hash_elem));
-}
-
-unsigned swap_hash_func(const struct hash_elem *element, void *aux UNUSED) {
-    /* Temp variable for hash computation. */
-    struct swap_slot *ss;
-
-    ss = hash_entry(element, struct swap_slot, hash_elem);
-    
-    /* The sector_ind is a unique identifier within the swap table. */
-    return hash_int((int) ss->sector_ind);
-}
-
-/* Less function used to compare hash elements */
-bool swap_hash_less(const struct hash_elem *a, const struct hash_elem *b,
-                    void *aux UNUSED) {
-    struct swap_slot *ssa, *ssb; 
-    ssa = hash_entry(a, struct swap_slot, hash_elem);
-    ssb = hash_entry(b, struct swap_slot, hash_elem);
-    return ssa->sector_ind < ssb->sector_ind;
 }